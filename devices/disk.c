@@ -1,12 +1,16 @@
 #include "devices/disk.h"
 #include <ctype.h>
 #include <debug.h>
+#include <list.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
 #include "devices/timer.h"
 #include "threads/io.h"
 #include "threads/interrupt.h"
+#include "threads/palloc.h"
 #include "threads/synch.h"
+#include "threads/vaddr.h"
 
 /* The code in this file is an interface to an ATA (IDE)
    controller.  It attempts to comply to [ATA-3]. */
@@ -31,7 +35,9 @@
 /* Alternate Status Register bits. */
 #define STA_BSY 0x80            /* Busy. */
 #define STA_DRDY 0x40           /* Device Ready. */
+#define STA_DF 0x20             /* Device Fault. */
 #define STA_DRQ 0x08            /* Data Request. */
+#define STA_ERR 0x01            /* Error. */
 
 /* Control Register bits. */
 #define CTL_SRST 0x04           /* Software Reset. */
@@ -47,6 +53,44 @@
 #define CMD_IDENTIFY_DEVICE 0xec        /* IDENTIFY DEVICE. */
 #define CMD_READ_SECTOR_RETRY 0x20      /* READ SECTOR with retries. */
 #define CMD_WRITE_SECTOR_RETRY 0x30     /* WRITE SECTOR with retries. */
+#define CMD_READ_DMA 0xc8               /* READ DMA. */
+#define CMD_WRITE_DMA 0xca              /* WRITE DMA. */
+
+/* PCI IDE bus master registers, relative to the channel's
+   bus master base.  [BMIDE] */
+#define reg_bm_command(CHANNEL) ((CHANNEL)->bm_base + 0)  /* Command. */
+#define reg_bm_status(CHANNEL) ((CHANNEL)->bm_base + 2)   /* Status. */
+#define reg_bm_prd(CHANNEL) ((CHANNEL)->bm_base + 4)      /* PRD table. */
+
+/* Bus Master Command Register bits. */
+#define BM_CMD_START 0x01       /* Start/stop transfer. */
+#define BM_CMD_READ 0x08        /* Transfer from disk to memory. */
+
+/* Bus Master Status Register bits. */
+#define BM_STA_ERR 0x02         /* Transfer failed (write 1 to clear). */
+#define BM_STA_INTR 0x04        /* Interrupt raised (write 1 to clear). */
+#define BM_STA_DMA0 0x20        /* Device 0 is DMA capable. */
+#define BM_STA_DMA1 0x40        /* Device 1 is DMA capable. */
+
+/* A physical region descriptor: one physically contiguous piece
+   of a DMA transfer.  A region may not cross a 64 kB boundary. */
+struct prd {
+	uint32_t addr;              /* Physical address. */
+	uint16_t size;              /* Byte count, 0 meaning 64 kB. */
+	uint16_t flags;             /* PRD_EOT on the last entry. */
+} __attribute__ ((packed));
+
+#define PRD_EOT 0x8000          /* End of table. */
+
+/* The PRD table fills a page.  That is more regions than a
+   DISK_MULTIPLE_MAX-sector command can need: one per merged
+   request plus one per 64 kB boundary crossed. */
+#define PRD_MAX (PGSIZE / sizeof (struct prd))
+
+/* How long, in timer ticks, a request may wait in the queue before
+   the deadline scheduler serves it ahead of the elevator order. */
+#define DEADLINE_READ (TIMER_FREQ / 2)
+#define DEADLINE_WRITE (TIMER_FREQ * 5)
 
 /* An ATA device. */
 struct disk {
@@ -56,6 +100,7 @@ struct disk {
 
 	bool is_ata;                /* 1=This device is an ATA disk. */
 	disk_sector_t capacity;     /* Capacity in sectors (if is_ata). */
+	bool use_dma;               /* Transfer by bus master DMA? */
 
 	long long read_cnt;         /* Number of sectors read. */
 	long long write_cnt;        /* Number of sectors written. */
@@ -68,11 +113,32 @@ struct channel {
 	uint16_t reg_base;          /* Base I/O port. */
 	uint8_t irq;                /* Interrupt in use. */
 
-	struct lock lock;           /* Must acquire to access the controller. */
 	bool expecting_interrupt;   /* True if an interrupt is expected, false if
 								   any interrupt would be spurious. */
 	struct semaphore completion_wait;   /* Up'd by interrupt handler. */
 
+	uint16_t bm_base;           /* Bus master I/O base, 0 if none. */
+	struct prd *prd;            /* PRD table, in a page of its own. */
+
+	/* Request queue.  Accessed only with interrupts off, since
+	   the interrupt handler starts each command when the previous
+	   one completes. */
+	struct list queue;          /* Requests waiting, in arrival order. */
+	disk_sector_t head;         /* Sector after the last one served. */
+
+	/* The command in progress, if BATCH is nonempty: one or more
+	   requests for consecutive sectors, merged into one transfer. */
+	struct list batch;          /* Its requests, in sector order. */
+	struct disk *batch_disk;    /* Disk it accesses. */
+	disk_sector_t batch_sector; /* First sector. */
+	size_t batch_cnt;           /* Number of sectors. */
+	bool batch_write;           /* Write or read? */
+	bool batch_dma;             /* By DMA, or by PIO? */
+	size_t batch_done;          /* Sectors transferred so far by PIO. */
+
+	long long req_cnt;          /* Requests served. */
+	long long merge_cnt;        /* Requests merged into another's command. */
+
 	struct disk devices[2];     /* The devices on this channel. */
 };
 
@@ -84,21 +150,50 @@ static void reset_channel (struct channel *);
 static bool check_device_type (struct disk *);
 static void identify_ata_device (struct disk *);
 
-static void select_sector (struct disk *, disk_sector_t);
-static void issue_pio_command (struct channel *, uint8_t command);
+static void select_sector (struct disk *, disk_sector_t, size_t cnt);
+static void issue_command (struct channel *, uint8_t command);
 static void input_sector (struct channel *, void *);
 static void output_sector (struct channel *, const void *);
 
 static void wait_until_idle (const struct disk *);
 static bool wait_while_busy (const struct disk *);
+static bool poll_while_busy (const struct disk *);
 static void select_device (const struct disk *);
 static void select_device_wait (const struct disk *);
 
+static uint16_t find_bus_master (void);
+static bool dma_addressable (const void *, size_t);
+
+static void start_batch (struct channel *);
+static void issue_batch (struct channel *);
+static void service_batch (struct channel *);
+
 static void interrupt_handler (struct intr_frame *);
 
+/* A request scheduler.  PICK chooses the next request to serve
+   from a channel's nonempty queue. */
+struct disk_scheduler {
+	const char *name;
+	struct disk_req *(*pick) (struct channel *);
+};
+
+static struct disk_req *pick_fifo (struct channel *);
+static struct disk_req *pick_clook (struct channel *);
+static struct disk_req *pick_deadline (struct channel *);
+
+static const struct disk_scheduler schedulers[] = {
+	{"fifo", pick_fifo},
+	{"clook", pick_clook},
+	{"deadline", pick_deadline},
+};
+
+/* The scheduler in use. */
+static const struct disk_scheduler *disk_scheduler = &schedulers[2];
+
 /* Initialize the disk subsystem and detect disks. */
 void
 disk_init (void) {
+	uint16_t bm_base = find_bus_master ();
 	size_t chan_no;
 
 	for (chan_no = 0; chan_no < CHANNEL_CNT; chan_no++) {
@@ -119,10 +214,19 @@ disk_init (void) {
 			default:
 				NOT_REACHED ();
 		}
-		lock_init (&c->lock);
 		c->expecting_interrupt = false;
 		sema_init (&c->completion_wait, 0);
 
+		/* The primary channel's bus master registers come first,
+		   the secondary's 8 bytes later. */
+		c->bm_base = bm_base != 0 ? bm_base + chan_no * 8 : 0;
+		c->prd = c->bm_base != 0 ? palloc_get_page (PAL_ASSERT) : NULL;
+
+		list_init (&c->queue);
+		list_init (&c->batch);
+		c->head = 0;
+		c->req_cnt = c->merge_cnt = 0;
+
 		/* Initialize devices. */
 		for (dev_no = 0; dev_no < 2; dev_no++) {
 			struct disk *d = &c->devices[dev_no];
@@ -132,6 +236,7 @@ disk_init (void) {
 
 			d->is_ata = false;
 			d->capacity = 0;
+			d->use_dma = false;
 
 			d->read_cnt = d->write_cnt = 0;
 		}
@@ -162,6 +267,7 @@ disk_print_stats (void) {
 	int chan_no;
 
 	for (chan_no = 0; chan_no < CHANNEL_CNT; chan_no++) {
+		struct channel *c = &channels[chan_no];
 		int dev_no;
 
 		for (dev_no = 0; dev_no < 2; dev_no++) {
@@ -170,6 +276,9 @@ disk_print_stats (void) {
 				printf ("%s: %lld reads, %lld writes\n",
 						d->name, d->read_cnt, d->write_cnt);
 		}
+		if (c->req_cnt > 0)
+			printf ("%s: %lld requests, %lld merged, %s scheduler\n",
+					c->name, c->req_cnt, c->merge_cnt, disk_scheduler->name);
 	}
 }
 
@@ -209,21 +318,7 @@ disk_size (struct disk *d) {
    per-disk locking is unneeded. */
 void
 disk_read (struct disk *d, disk_sector_t sec_no, void *buffer) {
-	struct channel *c;
-
-	ASSERT (d != NULL);
-	ASSERT (buffer != NULL);
-
-	c = d->channel;
-	lock_acquire (&c->lock);
-	select_sector (d, sec_no);
-	issue_pio_command (c, CMD_READ_SECTOR_RETRY);
-	sema_down (&c->completion_wait);
-	if (!wait_while_busy (d))
-		PANIC ("%s: disk read failed, sector=%"PRDSNu, d->name, sec_no);
-	input_sector (c, buffer);
-	d->read_cnt++;
-	lock_release (&c->lock);
+	disk_read_multiple (d, sec_no, buffer, 1);
 }
 
 /* Write sector SEC_NO to disk D from BUFFER, which must contain
@@ -233,23 +328,375 @@ disk_read (struct disk *d, disk_sector_t sec_no, void *buffer) {
    per-disk locking is unneeded. */
 void
 disk_write (struct disk *d, disk_sector_t sec_no, const void *buffer) {
-	struct channel *c;
+	disk_write_multiple (d, sec_no, buffer, 1);
+}
+
+/* Reads CNT consecutive sectors, starting at SEC_NO, from disk D
+   into BUFFER, which must have room for CNT * DISK_SECTOR_SIZE
+   bytes.  CNT must be between 1 and DISK_MULTIPLE_MAX.  The run is
+   a single command, possibly merged with other requests for
+   adjacent sectors: in DMA mode it raises a single interrupt, in
+   PIO mode one per sector.
+   Internally synchronizes accesses to disks, so external
+   per-disk locking is unneeded. */
+void
+disk_read_multiple (struct disk *d, disk_sector_t sec_no, void *buffer,
+		size_t cnt) {
+	struct disk_req req;
 
 	ASSERT (d != NULL);
 	ASSERT (buffer != NULL);
+	ASSERT (cnt >= 1 && cnt <= DISK_MULTIPLE_MAX);
+
+	req.disk = d;
+	req.sector = sec_no;
+	req.cnt = cnt;
+	req.buffer = buffer;
+	req.write = false;
+	req.complete = NULL;
+	disk_submit (&req);
+	disk_wait (&req);
+}
 
-	c = d->channel;
-	lock_acquire (&c->lock);
-	select_sector (d, sec_no);
-	issue_pio_command (c, CMD_WRITE_SECTOR_RETRY);
-	if (!wait_while_busy (d))
-		PANIC ("%s: disk write failed, sector=%"PRDSNu, d->name, sec_no);
-	output_sector (c, buffer);
-	sema_down (&c->completion_wait);
-	d->write_cnt++;
-	lock_release (&c->lock);
+/* Writes CNT consecutive sectors, starting at SEC_NO, to disk D
+   from BUFFER, which must contain CNT * DISK_SECTOR_SIZE bytes.
+   CNT must be between 1 and DISK_MULTIPLE_MAX.  Returns after the
+   disk has acknowledged receiving all of the data.
+   Internally synchronizes accesses to disks, so external
+   per-disk locking is unneeded. */
+void
+disk_write_multiple (struct disk *d, disk_sector_t sec_no,
+		const void *buffer, size_t cnt) {
+	struct disk_req req;
+
+	ASSERT (d != NULL);
+	ASSERT (buffer != NULL);
+	ASSERT (cnt >= 1 && cnt <= DISK_MULTIPLE_MAX);
+
+	req.disk = d;
+	req.sector = sec_no;
+	req.cnt = cnt;
+	req.buffer = (void *) buffer;
+	req.write = true;
+	req.complete = NULL;
+	disk_submit (&req);
+	disk_wait (&req);
 }
-
+
+/* Request scheduling.
+
+   Each channel serves one command at a time.  When it finishes,
+   the interrupt handler asks the scheduler for the next request,
+   then merges into its command any queued requests for the
+   sectors just before or after it on the same disk, in the same
+   direction.  Requests in flight together must not overlap. */
+
+/* Selects the request scheduler called NAME: "fifo", "clook" or
+   "deadline".  Returns false if there is no such scheduler. */
+bool
+disk_set_scheduler (const char *name) {
+	size_t i;
+
+	for (i = 0; i < sizeof schedulers / sizeof *schedulers; i++)
+		if (!strcmp (schedulers[i].name, name)) {
+			disk_scheduler = &schedulers[i];
+			return true;
+		}
+	return false;
+}
+
+/* First come, first served. */
+static struct disk_req *
+pick_fifo (struct channel *c) {
+	return list_entry (list_front (&c->queue), struct disk_req, elem);
+}
+
+/* C-LOOK elevator: the lowest sector at or beyond the head, or,
+   if there is none, the lowest sector overall, so that the head
+   sweeps upward and then returns to the start. */
+static struct disk_req *
+pick_clook (struct channel *c) {
+	struct disk_req *ahead = NULL, *lowest = NULL;
+	struct list_elem *e;
+
+	for (e = list_begin (&c->queue); e != list_end (&c->queue);
+			e = list_next (e)) {
+		struct disk_req *r = list_entry (e, struct disk_req, elem);
+		if (lowest == NULL || r->sector < lowest->sector)
+			lowest = r;
+		if (r->sector >= c->head && (ahead == NULL || r->sector < ahead->sector))
+			ahead = r;
+	}
+	return ahead != NULL ? ahead : lowest;
+}
+
+/* C-LOOK, except that once some request's deadline has passed,
+   the request whose deadline passed first is served, so that no
+   request starves.  Reads and writes have different deadlines and
+   share one queue, so the expired request need not be at its
+   front. */
+static struct disk_req *
+pick_deadline (struct channel *c) {
+	int64_t now = timer_ticks ();
+	struct disk_req *expired = NULL;
+	struct list_elem *e;
+
+	for (e = list_begin (&c->queue); e != list_end (&c->queue);
+			e = list_next (e)) {
+		struct disk_req *r = list_entry (e, struct disk_req, elem);
+		if (now >= r->deadline
+				&& (expired == NULL || r->deadline < expired->deadline))
+			expired = r;
+	}
+	return expired != NULL ? expired : pick_clook (c);
+}
+
+/* Queues REQ on its disk's channel, starting it at once if the
+   channel is idle, and returns without waiting for it.  See
+   struct disk_req for how completion is reported.  May be called
+   with interrupts off, but not from an interrupt handler.
+   Internally synchronizes accesses to disks, so external
+   per-disk locking is unneeded. */
+void
+disk_submit (struct disk_req *req) {
+	struct channel *c;
+	enum intr_level old_level;
+
+	ASSERT (req != NULL && req->disk != NULL && req->buffer != NULL);
+	ASSERT (req->cnt >= 1 && req->cnt <= DISK_MULTIPLE_MAX);
+	ASSERT (!intr_context ());
+
+	c = req->disk->channel;
+	sema_init (&req->done, 0);
+	req->deadline = timer_ticks () + (req->write ? DEADLINE_WRITE
+			: DEADLINE_READ);
+
+	old_level = intr_disable ();
+	list_push_back (&c->queue, &req->elem);
+	if (list_empty (&c->batch))
+		start_batch (c);
+	intr_set_level (old_level);
+}
+
+/* Waits for REQ, which must have been passed to disk_submit()
+   without a completion function, to complete. */
+void
+disk_wait (struct disk_req *req) {
+	ASSERT (req->complete == NULL);
+
+	sema_down (&req->done);
+}
+
+/* Tries to merge a queued request into channel C's batch.
+   Returns true if one was merged. */
+static bool
+merge_request (struct channel *c) {
+	struct list_elem *e;
+
+	for (e = list_begin (&c->queue); e != list_end (&c->queue);
+			e = list_next (e)) {
+		struct disk_req *r = list_entry (e, struct disk_req, elem);
+
+		if (r->disk != c->batch_disk || r->write != c->batch_write
+				|| c->batch_cnt + r->cnt > DISK_MULTIPLE_MAX)
+			continue;
+		if (r->sector == c->batch_sector + c->batch_cnt) {
+			list_remove (&r->elem);
+			list_push_back (&c->batch, &r->elem);
+		} else if (r->sector + r->cnt == c->batch_sector) {
+			list_remove (&r->elem);
+			list_push_front (&c->batch, &r->elem);
+			c->batch_sector = r->sector;
+		} else
+			continue;
+		c->batch_cnt += r->cnt;
+		c->merge_cnt++;
+		return true;
+	}
+	return false;
+}
+
+/* Describes the buffers of channel C's batch in its PRD table,
+   splitting them at 64 kB boundaries.  Returns false if some
+   buffer cannot be reached by DMA. */
+static bool
+build_prd_table (struct channel *c) {
+	struct list_elem *e;
+	size_t n = 0;
+
+	for (e = list_begin (&c->batch); e != list_end (&c->batch);
+			e = list_next (e)) {
+		struct disk_req *r = list_entry (e, struct disk_req, elem);
+		const uint8_t *data = r->buffer;
+		size_t size = r->cnt * DISK_SECTOR_SIZE;
+
+		if (!dma_addressable (data, size))
+			return false;
+		while (size > 0) {
+			uint64_t paddr = vtop (data);
+			size_t region = 0x10000 - (paddr & 0xffff);
+			if (region > size)
+				region = size;
+
+			ASSERT (n < PRD_MAX);
+			c->prd[n].addr = paddr;
+			c->prd[n].size = region & 0xffff;
+			c->prd[n].flags = 0;
+			n++;
+
+			data += region;
+			size -= region;
+		}
+	}
+	c->prd[n - 1].flags = PRD_EOT;
+	return true;
+}
+
+/* If channel C has queued requests, picks one with the current
+   scheduler, merges what it can into it and starts the command.
+   Interrupts must be off. */
+static void
+start_batch (struct channel *c) {
+	struct disk_req *r;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (list_empty (&c->batch));
+
+	if (list_empty (&c->queue))
+		return;
+
+	r = disk_scheduler->pick (c);
+	list_remove (&r->elem);
+	list_push_back (&c->batch, &r->elem);
+	c->batch_disk = r->disk;
+	c->batch_sector = r->sector;
+	c->batch_cnt = r->cnt;
+	c->batch_write = r->write;
+	c->req_cnt++;
+	while (merge_request (c))
+		continue;
+
+	c->batch_dma = c->batch_disk->use_dma && build_prd_table (c);
+	c->head = c->batch_sector + c->batch_cnt;
+	issue_batch (c);
+}
+
+/* Returns the buffer for sector IDX of channel C's batch. */
+static void *
+batch_buffer (struct channel *c, size_t idx) {
+	struct list_elem *e;
+
+	for (e = list_begin (&c->batch); e != list_end (&c->batch);
+			e = list_next (e)) {
+		struct disk_req *r = list_entry (e, struct disk_req, elem);
+		if (idx < r->cnt)
+			return (uint8_t *) r->buffer + idx * DISK_SECTOR_SIZE;
+		idx -= r->cnt;
+	}
+	NOT_REACHED ();
+}
+
+/* Sends channel C's batch to its disk.  Completion is reported by
+   interrupt, to service_batch(). */
+static void
+issue_batch (struct channel *c) {
+	struct disk *d = c->batch_disk;
+
+	c->batch_done = 0;
+	if (c->batch_dma) {
+		uint8_t direction = c->batch_write ? 0 : BM_CMD_READ;
+
+		outl (reg_bm_prd (c), vtop (c->prd));
+		outb (reg_bm_command (c), direction);
+		outb (reg_bm_status (c), inb (reg_bm_status (c))
+				| BM_STA_ERR | BM_STA_INTR);
+		select_sector (d, c->batch_sector, c->batch_cnt);
+		issue_command (c, c->batch_write ? CMD_WRITE_DMA : CMD_READ_DMA);
+		outb (reg_bm_command (c), direction | BM_CMD_START);
+	} else {
+		select_sector (d, c->batch_sector, c->batch_cnt);
+		if (!c->batch_write)
+			issue_command (c, CMD_READ_SECTOR_RETRY);
+		else {
+			/* The disk asks for the first sector without raising an
+			   interrupt, and for each later one with an interrupt. */
+			issue_command (c, CMD_WRITE_SECTOR_RETRY);
+			if (!poll_while_busy (d))
+				PANIC ("%s: disk write failed, sector=%"PRDSNu,
+						d->name, c->batch_sector);
+			output_sector (c, batch_buffer (c, 0));
+		}
+	}
+}
+
+/* Completes the requests in channel C's batch and starts the next
+   command. */
+static void
+finish_batch (struct channel *c) {
+	struct disk *d = c->batch_disk;
+
+	while (!list_empty (&c->batch)) {
+		struct disk_req *r = list_entry (list_pop_front (&c->batch),
+				struct disk_req, elem);
+		if (r->write)
+			d->write_cnt += r->cnt;
+		else
+			d->read_cnt += r->cnt;
+		if (r->complete != NULL)
+			r->complete (r);
+		else
+			sema_up (&r->done);
+	}
+	start_batch (c);
+}
+
+/* Handles the interrupt for channel C's batch.  Runs in the
+   interrupt handler, so interrupts are off. */
+static void
+service_batch (struct channel *c) {
+	struct disk *d = c->batch_disk;
+	uint8_t status = inb (reg_status (c));  /* Acknowledges interrupt. */
+
+	if (c->batch_dma) {
+		uint8_t bm_status = inb (reg_bm_status (c));
+
+		outb (reg_bm_status (c), bm_status);
+		outb (reg_bm_command (c), c->batch_write ? 0 : BM_CMD_READ);
+		if ((status & (STA_ERR | STA_DF)) || (bm_status & BM_STA_ERR)) {
+			printf ("%s: DMA %s failed, sector=%"PRDSNu"; using PIO\n",
+					d->name, c->batch_write ? "write" : "read", c->batch_sector);
+			d->use_dma = false;
+			c->batch_dma = false;
+			issue_batch (c);
+			return;
+		}
+		finish_batch (c);
+		return;
+	}
+
+	if (status & (STA_ERR | STA_DF))
+		PANIC ("%s: disk %s failed, sector=%"PRDSNu, d->name,
+				c->batch_write ? "write" : "read",
+				(disk_sector_t) (c->batch_sector + c->batch_done));
+	if (!c->batch_write) {
+		if (!(status & STA_DRQ))
+			PANIC ("%s: disk read failed, sector=%"PRDSNu, d->name,
+					(disk_sector_t) (c->batch_sector + c->batch_done));
+		input_sector (c, batch_buffer (c, c->batch_done));
+		c->batch_done++;
+	} else {
+		c->batch_done++;
+		if (c->batch_done < c->batch_cnt) {
+			if (!poll_while_busy (d))
+				PANIC ("%s: disk write failed, sector=%"PRDSNu, d->name,
+						(disk_sector_t) (c->batch_sector + c->batch_done));
+			output_sector (c, batch_buffer (c, c->batch_done));
+		}
+	}
+	if (c->batch_done == c->batch_cnt)
+		finish_batch (c);
+}
+
 /* Disk detection and identification. */
 
 static void print_ata_string (char *string, size_t size);
@@ -353,7 +800,7 @@ identify_ata_device (struct disk *d) {
 	   indicating the device's response is ready, and read the data
 	   into our buffer. */
 	select_device_wait (d);
-	issue_pio_command (c, CMD_IDENTIFY_DEVICE);
+	issue_command (c, CMD_IDENTIFY_DEVICE);
 	sema_down (&c->completion_wait);
 	if (!wait_while_busy (d)) {
 		d->is_ata = false;
@@ -364,6 +811,14 @@ identify_ata_device (struct disk *d) {
 	/* Calculate capacity. */
 	d->capacity = id[60] | ((uint32_t) id[61] << 16);
 
+	/* Use DMA if both the disk (word 49, bit 8) and the channel
+	   support it, and tell the controller so. */
+	if (c->bm_base != 0 && (id[49] & (1 << 8))) {
+		d->use_dma = true;
+		outb (reg_bm_status (c), inb (reg_bm_status (c))
+				| (d->dev_no == 0 ? BM_STA_DMA0 : BM_STA_DMA1));
+	}
+
 	/* Print identification message. */
 	printf ("%s: detected %'"PRDSNu" sector (", d->name, d->capacity);
 	if (d->capacity > 1024 / DISK_SECTOR_SIZE * 1024 * 1024)
@@ -375,7 +830,7 @@ identify_ata_device (struct disk *d) {
 		printf ("%"PRDSNu" kB", d->capacity / (1024 / DISK_SECTOR_SIZE));
 	else
 		printf ("%"PRDSNu" byte", d->capacity * DISK_SECTOR_SIZE);
-	printf (") disk, model \"");
+	printf (") disk%s, model \"", d->use_dma ? " (DMA)" : "");
 	print_ata_string ((char *) &id[27], 40);
 	printf ("\", serial \"");
 	print_ata_string ((char *) &id[10], 20);
@@ -402,17 +857,18 @@ print_ata_string (char *string, size_t size) {
 }
 
 /* Selects device D, waiting for it to become ready, and then
-   writes SEC_NO to the disk's sector selection registers.  (We
-   use LBA mode.) */
+   writes SEC_NO and CNT to the disk's sector selection and count
+   registers.  (We use LBA mode.) */
 static void
-select_sector (struct disk *d, disk_sector_t sec_no) {
+select_sector (struct disk *d, disk_sector_t sec_no, size_t cnt) {
 	struct channel *c = d->channel;
 
-	ASSERT (sec_no < d->capacity);
-	ASSERT (sec_no < (1UL << 28));
+	ASSERT (sec_no < d->capacity && cnt <= d->capacity - sec_no);
+	ASSERT (sec_no + cnt <= (1UL << 28));
+	ASSERT (cnt >= 1 && cnt <= DISK_MULTIPLE_MAX);
 
 	select_device_wait (d);
-	outb (reg_nsect (c), 1);
+	outb (reg_nsect (c), cnt);      /* 256 wraps to 0, which means 256. */
 	outb (reg_lbal (c), sec_no);
 	outb (reg_lbam (c), sec_no >> 8);
 	outb (reg_lbah (c), (sec_no >> 16));
@@ -421,13 +877,10 @@ select_sector (struct disk *d, disk_sector_t sec_no) {
 }
 
 /* Writes COMMAND to channel C and prepares for receiving a
-   completion interrupt. */
+   completion interrupt, which is handled once interrupts are
+   on. */
 static void
-issue_pio_command (struct channel *c, uint8_t command) {
-	/* Interrupts must be enabled or our semaphore will never be
-	   up'd by the completion handler. */
-	ASSERT (intr_get_level () == INTR_ON);
-
+issue_command (struct channel *c, uint8_t command) {
 	c->expecting_interrupt = true;
 	outb (reg_command (c), command);
 }
@@ -446,6 +899,86 @@ output_sector (struct channel *c, const void *sector) {
 	outsw (reg_data (c), sector, DISK_SECTOR_SIZE / 2);
 }
 
+/* Bus master DMA. */
+
+/* PCI configuration space access mechanism #1. */
+#define PCI_CONFIG_ADDR 0xcf8
+#define PCI_CONFIG_DATA 0xcfc
+
+/* PCI configuration registers and bits used below. */
+#define PCI_REG_ID 0x00                 /* Vendor and device ID. */
+#define PCI_REG_COMMAND 0x04            /* Command register. */
+#define PCI_REG_CLASS 0x08              /* Class, subclass, interface. */
+#define PCI_REG_BAR4 0x20               /* Bus master I/O base, for IDE. */
+#define PCI_COMMAND_IO 0x0001           /* Respond to I/O accesses. */
+#define PCI_COMMAND_MASTER 0x0004       /* May act as bus master. */
+
+/* Reads 32-bit register REG of PCI function BUS:DEV.FUNC. */
+static uint32_t
+pci_read_config (int bus, int dev, int func, int reg) {
+	outl (PCI_CONFIG_ADDR, 0x80000000u | (bus << 16) | (dev << 11)
+			| (func << 8) | (reg & 0xfc));
+	return inl (PCI_CONFIG_DATA);
+}
+
+/* Writes DATA to 32-bit register REG of PCI function
+   BUS:DEV.FUNC. */
+static void
+pci_write_config (int bus, int dev, int func, int reg, uint32_t data) {
+	outl (PCI_CONFIG_ADDR, 0x80000000u | (bus << 16) | (dev << 11)
+			| (func << 8) | (reg & 0xfc));
+	outl (PCI_CONFIG_DATA, data);
+}
+
+/* Looks on PCI bus 0 for an IDE controller that drives the two
+   legacy channels and supports bus mastering, as the PIIX
+   emulated by QEMU and Bochs does.  If there is one, enables it
+   as a bus master and returns its bus master I/O base;
+   otherwise returns 0, and all disks use PIO. */
+static uint16_t
+find_bus_master (void) {
+	int dev, func;
+
+	for (dev = 0; dev < 32; dev++)
+		for (func = 0; func < 8; func++) {
+			uint32_t class, bar4;
+
+			if ((pci_read_config (0, dev, func, PCI_REG_ID) & 0xffff) == 0xffff)
+				continue;
+
+			/* Mass storage (0x01), IDE (0x01), with the bus master
+			   bit (0x80) set and both channels in compatibility
+			   mode (0x05 clear) in the programming interface. */
+			class = pci_read_config (0, dev, func, PCI_REG_CLASS);
+			if ((class >> 16) != 0x0101 || (class & 0x8000) == 0
+					|| (class & 0x0500) != 0)
+				continue;
+
+			bar4 = pci_read_config (0, dev, func, PCI_REG_BAR4);
+			if ((bar4 & 1) == 0 || (bar4 & 0xfffc) == 0)
+				continue;
+
+			pci_write_config (0, dev, func, PCI_REG_COMMAND,
+					pci_read_config (0, dev, func, PCI_REG_COMMAND)
+					| PCI_COMMAND_IO | PCI_COMMAND_MASTER);
+			return bar4 & 0xfffc;
+		}
+	return 0;
+}
+
+/* Returns true if the SIZE bytes at BUFFER can be the target of a
+   DMA transfer: directly mapped, and so physically contiguous,
+   below 4 GB and word aligned. */
+static bool
+dma_addressable (const void *buffer, size_t size) {
+	uint64_t paddr;
+
+	if (!is_kernel_vaddr (buffer))
+		return false;
+	paddr = vtop (buffer);
+	return (paddr & 1) == 0 && paddr + size <= 0x100000000ull;
+}
+
 /* Low-level ATA primitives. */
 
 /* Wait up to 10 seconds for the controller to become idle, that
@@ -460,7 +993,7 @@ wait_until_idle (const struct disk *d) {
 	for (i = 0; i < 1000; i++) {
 		if ((inb (reg_status (d->channel)) & (STA_BSY | STA_DRQ)) == 0)
 			return;
-		timer_usleep (10);
+		timer_udelay (10);
 	}
 
 	printf ("%s: idle timeout\n", d->name);
@@ -490,6 +1023,22 @@ wait_while_busy (const struct disk *d) {
 	return false;
 }
 
+/* Wait up to 10 milliseconds for disk D to clear BSY, without
+   sleeping, and then return the status of the DRQ bit.  For use
+   with interrupts off, once a command is under way. */
+static bool
+poll_while_busy (const struct disk *d) {
+	struct channel *c = d->channel;
+	int i;
+
+	for (i = 0; i < 1000; i++) {
+		if (!(inb (reg_alt_status (c)) & STA_BSY))
+			return (inb (reg_alt_status (c)) & STA_DRQ) != 0;
+		timer_udelay (10);
+	}
+	return false;
+}
+
 /* Program D's channel so that D is now the selected disk. */
 static void
 select_device (const struct disk *d) {
@@ -499,7 +1048,7 @@ select_device (const struct disk *d) {
 		dev |= DEV_DEV;
 	outb (reg_device (c), dev);
 	inb (reg_alt_status (c));
-	timer_nsleep (400);
+	timer_ndelay (400);
 }
 
 /* Select disk D in its channel, as select_device(), but wait for
@@ -518,7 +1067,9 @@ interrupt_handler (struct intr_frame *f) {
 
 	for (c = channels; c < channels + CHANNEL_CNT; c++)
 		if (f->vec_no == c->irq) {
-			if (c->expecting_interrupt) {
+			if (!list_empty (&c->batch))
+				service_batch (c);                  /* Queued request. */
+			else if (c->expecting_interrupt) {
 				inb (reg_status (c));               /* Acknowledge interrupt. */
 				sema_up (&c->completion_wait);      /* Wake up waiter. */
 			} else
@@ -7,6 +7,7 @@
 #include "threads/io.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
+#include "intrinsic.h"
 
 /* See [8254] for hardware details of the 8254 timer chip. */
 
@@ -17,17 +18,42 @@
 #error TIMER_FREQ <= 1000 recommended
 #endif
 
+/* 8254 input frequency, in Hz. */
+#define PIT_HZ 1193180
+
 /* Number of timer ticks since OS booted. */
 static int64_t ticks;
 
+/* If true, the idle thread stops the periodic tick while it
+   sleeps.  Set by kernel command-line option "-tickless". */
+bool timer_tickless;
+
+/* PIT counts per timer tick, and the longest one-shot that fits
+   in the 16-bit counter, in ticks. */
+static uint16_t pit_count;
+static int64_t oneshot_max_ticks;
+
+/* Ticks covered by the armed one-shot, or 0 while the PIT runs
+   in periodic mode. */
+static int64_t oneshot_ticks;
+
 /* Number of loops per timer tick.
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
 
+/* Cost of the timer interrupt handler, in time-stamp counter
+   cycles. */
+static struct timer_intr_stats intr_stats;
+
 static intr_handler_func timer_interrupt;
+static void pit_periodic (void);
+static void pit_oneshot (uint16_t count);
+static uint16_t pit_read_count (void);
+static void timer_catch_up (int64_t elapsed);
 static bool too_many_loops (unsigned loops);
 static void busy_wait (int64_t loops);
 static void real_time_sleep (int64_t num, int32_t denom);
+static void real_time_delay (int64_t num, int32_t denom);
 
 /* Sets up the 8254 Programmable Interval Timer (PIT) to
    interrupt PIT_FREQ times per second, and registers the
@@ -36,11 +62,9 @@ void
 timer_init (void) {
 	/* 8254 input frequency divided by TIMER_FREQ, rounded to
 	   nearest. */
-	uint16_t count = (1193180 + TIMER_FREQ / 2) / TIMER_FREQ;
-
-	outb (0x43, 0x34);    /* CW: counter 0, LSB then MSB, mode 2, binary. */
-	outb (0x40, count & 0xff);
-	outb (0x40, count >> 8);
+	pit_count = (PIT_HZ + TIMER_FREQ / 2) / TIMER_FREQ;
+	oneshot_max_ticks = 0xffff / pit_count;
+	pit_periodic ();
 
 	intr_register_ext (0x20, timer_interrupt, "8254 Timer");
 }
@@ -119,20 +143,166 @@ timer_nsleep (int64_t ns) {
 	real_time_sleep (ns, 1000 * 1000 * 1000);
 }
 
+/* Busy-waits for approximately US microseconds.  Unlike
+   timer_usleep(), does not require interrupts to be on, so it may
+   be used in interrupt handlers.  Only for short delays. */
+void
+timer_udelay (int64_t us) {
+	real_time_delay (us, 1000 * 1000);
+}
+
+/* Busy-waits for approximately NS nanoseconds.  Unlike
+   timer_nsleep(), does not require interrupts to be on, so it may
+   be used in interrupt handlers. */
+void
+timer_ndelay (int64_t ns) {
+	real_time_delay (ns, 1000 * 1000 * 1000);
+}
+
+/* Called by the idle thread, with interrupts off, just before it
+   halts.  In tickless mode, replaces the periodic tick by a
+   single interrupt at the earliest sleeper's deadline, as far as
+   the 16-bit PIT counter allows. */
+void
+timer_idle_enter (void) {
+	int64_t delta;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+	if (!timer_tickless || oneshot_ticks != 0)
+		return;
+
+	delta = get_next_tick_to_awake () - ticks;
+	if (delta > oneshot_max_ticks)
+		delta = oneshot_max_ticks;
+	if (delta <= 1)
+		return;
+
+	oneshot_ticks = delta;
+	pit_oneshot (delta * pit_count);
+}
+
+/* Called by the scheduler, with interrupts off, when it switches
+   away from the idle thread.  If the idle thread was woken by
+   something other than the one-shot, restarts the periodic tick
+   and catches up on the ticks that passed.  Returns the number
+   of ticks caught up, all of which were spent idle.  Only the
+   tick count and the sleepers are brought up to date here: the
+   caller must do the per-tick work of thread_tick() for each of
+   the returned ticks. */
+int64_t
+timer_idle_exit (void) {
+	uint16_t left;
+	int64_t elapsed;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+	if (oneshot_ticks == 0)
+		return 0;
+
+	left = pit_read_count ();
+	pit_periodic ();
+	if (left == 0 || left > oneshot_ticks * pit_count) {
+		/* Already expired: the counter wrapped past zero and the
+		   interrupt is pending.  It will account for the final
+		   tick as an ordinary periodic one. */
+		elapsed = oneshot_ticks - 1;
+	} else
+		elapsed = (oneshot_ticks * pit_count - left) / pit_count;
+	oneshot_ticks = 0;
+
+	ticks += elapsed;
+	thread_awake (ticks);
+	return elapsed;
+}
+
 /* Prints timer statistics. */
 void
 timer_print_stats (void) {
 	printf ("Timer: %"PRId64" ticks\n", timer_ticks ());
+	if (timer_tickless)
+		printf ("Timer: %"PRId64" interrupts (tickless idle)\n",
+				intr_stats.count);
 }
 
+/* Copies the timer interrupt handler statistics into STATS. */
+void
+timer_get_intr_stats (struct timer_intr_stats *stats) {
+	enum intr_level old_level = intr_disable ();
+	*stats = intr_stats;
+	intr_set_level (old_level);
+}
+
+/* Clears the timer interrupt handler statistics. */
+void
+timer_reset_intr_stats (void) {
+	enum intr_level old_level = intr_disable ();
+	intr_stats = (struct timer_intr_stats) { 0 };
+	intr_set_level (old_level);
+}
+
 /* Timer interrupt handler. */
 static void
 timer_interrupt (struct intr_frame *args UNUSED) {
-	ticks++;
-	thread_tick ();
+	uint64_t start = rdtsc ();
+	uint64_t cycles;
+
+	if (oneshot_ticks != 0) {
+		/* The one-shot armed by timer_idle_enter() expired. */
+		int64_t elapsed = oneshot_ticks;
+
+		pit_periodic ();
+		oneshot_ticks = 0;
+		timer_catch_up (elapsed);
+	} else
+		timer_catch_up (1);
+
+	cycles = rdtsc () - start;
+	intr_stats.count++;
+	intr_stats.cycles += cycles;
+	if (cycles > intr_stats.max_cycles)
+		intr_stats.max_cycles = cycles;
+}
+
+/* Advances the tick count by ELAPSED ticks, running the
+   scheduler's per-tick work for each, and wakes any sleepers that
+   are now due.  Must be called from the timer interrupt. */
+static void
+timer_catch_up (int64_t elapsed) {
+	while (elapsed-- > 0) {
+		ticks++;
+		thread_tick ();
+	}
 	thread_awake (ticks);
 }
 
+/* Puts PIT counter 0 in periodic mode, interrupting TIMER_FREQ
+   times per second. */
+static void
+pit_periodic (void) {
+	outb (0x43, 0x34);    /* CW: counter 0, LSB then MSB, mode 2, binary. */
+	outb (0x40, pit_count & 0xff);
+	outb (0x40, pit_count >> 8);
+}
+
+/* Makes PIT counter 0 interrupt once, COUNT input clocks from
+   now. */
+static void
+pit_oneshot (uint16_t count) {
+	outb (0x43, 0x30);    /* CW: counter 0, LSB then MSB, mode 0, binary. */
+	outb (0x40, count & 0xff);
+	outb (0x40, count >> 8);
+}
+
+/* Returns the current value of PIT counter 0. */
+static uint16_t
+pit_read_count (void) {
+	uint8_t lo, hi;
+
+	outb (0x43, 0x00);    /* CW: latch counter 0. */
+	lo = inb (0x40);
+	hi = inb (0x40);
+	return lo | (hi << 8);
+}
+
 /* Returns true if LOOPS iterations waits for more than one timer
    tick, otherwise false. */
 static bool
@@ -164,6 +334,15 @@ busy_wait (int64_t loops) {
 		barrier ();
 }
 
+/* Busy-wait for approximately NUM/DENOM seconds. */
+static void
+real_time_delay (int64_t num, int32_t denom) {
+	/* Scale the numerator and denominator down by 1000 to avoid
+	   the possibility of overflow. */
+	ASSERT (denom % 1000 == 0);
+	busy_wait (loops_per_tick * num / 1000 * TIMER_FREQ / (denom / 1000));
+}
+
 /* Sleep for approximately NUM/DENOM seconds. */
 static void
 real_time_sleep (int64_t num, int32_t denom) {
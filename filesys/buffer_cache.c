@@ -0,0 +1,475 @@
+/* buffer_cache.c: Write-back cache of file system disk sectors. */
+
+#include "filesys/buffer_cache.h"
+#include <debug.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "filesys/filesys.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* A cache entry.
+ * SECTOR, IN_USE, ACCESSED and PIN_CNT are protected by
+ * cache_lock; the rest by LOCK.  An entry is only chosen for
+ * eviction while its PIN_CNT is 0, so no thread holds or waits
+ * for its LOCK then. */
+struct cache_entry {
+	disk_sector_t sector;               /* Sector held, if IN_USE. */
+	bool in_use;                        /* Holds a sector? */
+	bool accessed;                      /* Used since the clock hand passed? */
+	int pin_cnt;                        /* Threads using or waiting for it. */
+
+	struct lock lock;                   /* Serializes access to DATA. */
+	bool loaded;                        /* DATA read in or fully written? */
+	bool dirty;                         /* DATA newer than the disk? */
+	int64_t dirty_since;                /* Tick DIRTY was last set. */
+	uint8_t data[DISK_SECTOR_SIZE];     /* Sector contents. */
+};
+
+static struct cache_entry cache[BUFFER_CACHE_SIZE];
+static struct lock cache_lock;          /* Guards the sector mapping. */
+static struct condition cache_unpinned; /* Some PIN_CNT dropped to 0. */
+static size_t clock_hand;               /* Next entry to consider. */
+static int dirty_cnt;                   /* Entries with DIRTY set. */
+static struct condition dirty_nonzero;  /* Signaled when DIRTY_CNT rises. */
+
+/* Sectors being written back are gathered here, so that each
+ * run of consecutive sectors goes to disk as a single request. */
+static struct lock flush_lock;          /* Guards flush_buf, flush_reqs. */
+static uint8_t flush_buf[BUFFER_CACHE_SIZE * DISK_SECTOR_SIZE];
+static struct disk_req flush_reqs[BUFFER_CACHE_SIZE];
+
+static long long hit_cnt;               /* Lookups that found the sector. */
+static long long miss_cnt;              /* Lookups that had to evict. */
+static long long readahead_cnt;         /* Sectors loaded by read-ahead. */
+
+/* Sectors waiting to be read ahead, in request order.  Requests
+ * that arrive while the queue is full are dropped. */
+#define READAHEAD_QUEUE_SIZE 64
+static disk_sector_t ra_queue[READAHEAD_QUEUE_SIZE];
+static size_t ra_head;                  /* Oldest request. */
+static size_t ra_cnt;                   /* Number of requests queued. */
+static struct lock ra_lock;             /* Guards the queue. */
+static struct condition ra_nonempty;    /* Signaled when RA_CNT rises. */
+
+/* Maximum number of read-ahead reads kept in flight at once. */
+#define READAHEAD_BATCH 8
+static struct disk_req ra_reqs[READAHEAD_BATCH];
+
+static void readahead_daemon (void *aux);
+static void flush_daemon (void *aux);
+
+/* Initializes the buffer cache. */
+void
+buffer_cache_init (void) {
+	size_t i;
+
+	lock_init (&cache_lock);
+	cond_init (&cache_unpinned);
+	cond_init (&dirty_nonzero);
+	lock_init (&flush_lock);
+	for (i = 0; i < BUFFER_CACHE_SIZE; i++)
+		lock_init (&cache[i].lock);
+
+	lock_init (&ra_lock);
+	cond_init (&ra_nonempty);
+	thread_create ("readahead", PRI_DEFAULT, readahead_daemon, NULL);
+	thread_create ("flusher", PRI_DEFAULT, flush_daemon, NULL);
+}
+
+/* Returns the entry holding SECTOR, or a null pointer if there
+ * is none.  cache_lock must be held. */
+static struct cache_entry *
+lookup (disk_sector_t sector) {
+	size_t i;
+
+	for (i = 0; i < BUFFER_CACHE_SIZE; i++)
+		if (cache[i].in_use && cache[i].sector == sector)
+			return &cache[i];
+	return NULL;
+}
+
+/* Chooses an entry to hold a new sector with the clock
+ * algorithm, writing its old contents back to disk if they are
+ * dirty.  Waits for an entry to be released if all of them are
+ * pinned.  cache_lock must be held.  It is released during the
+ * write-back, so the sector mapping may have changed by the time
+ * this returns. */
+static struct cache_entry *
+evict (void) {
+	for (;;) {
+		size_t n;
+
+		/* Two sweeps clear every accessed bit, so this finds an
+		 * unpinned entry if there is one. */
+		for (n = 0; n < 2 * BUFFER_CACHE_SIZE; n++) {
+			struct cache_entry *e = &cache[clock_hand];
+			clock_hand = (clock_hand + 1) % BUFFER_CACHE_SIZE;
+
+			if (!e->in_use)
+				return e;
+			if (e->pin_cnt > 0)
+				continue;
+			if (e->accessed) {
+				e->accessed = false;
+				continue;
+			}
+
+			if (e->dirty) {
+				int dirty_delta = 0;
+
+				/* Write it back without holding cache_lock, so that
+				 * lookups of other sectors need not wait for the
+				 * disk.  The pin keeps other evictors from choosing
+				 * the entry in the meantime. */
+				e->pin_cnt++;
+				lock_release (&cache_lock);
+
+				lock_acquire (&e->lock);
+				if (e->dirty) {
+					disk_write (filesys_disk, e->sector, e->data);
+					e->dirty = false;
+					dirty_delta = -1;
+				}
+				lock_release (&e->lock);
+
+				lock_acquire (&cache_lock);
+				dirty_cnt += dirty_delta;
+				if (--e->pin_cnt > 0 || e->dirty || e->accessed) {
+					/* Someone used it while it was being written. */
+					if (e->pin_cnt == 0)
+						cond_signal (&cache_unpinned, &cache_lock);
+					continue;
+				}
+			}
+			return e;
+		}
+		cond_wait (&cache_unpinned, &cache_lock);
+	}
+}
+
+/* Evicts an entry and makes it hold SECTOR, not yet loaded, with
+ * one pin taken.  If another thread cached SECTOR while evict()
+ * was writing back, pins and returns that entry instead.
+ * cache_lock must be held. */
+static struct cache_entry *
+install (disk_sector_t sector) {
+	struct cache_entry *e = evict ();
+	struct cache_entry *cached = lookup (sector);
+
+	if (cached != NULL) {
+		cached->accessed = true;
+		cached->pin_cnt++;
+		return cached;
+	}
+
+	e->sector = sector;
+	e->in_use = true;
+	e->accessed = true;
+	e->pin_cnt = 1;
+	e->loaded = false;
+	e->dirty = false;
+	return e;
+}
+
+/* Returns the entry for SECTOR with its lock held.  Reads the
+ * sector from disk if it is not cached, unless OVERWRITE is true
+ * because the caller is about to replace all of it. */
+static struct cache_entry *
+acquire_entry (disk_sector_t sector, bool overwrite) {
+	struct cache_entry *e;
+
+	lock_acquire (&cache_lock);
+	e = lookup (sector);
+	if (e != NULL) {
+		hit_cnt++;
+		e->accessed = true;
+		e->pin_cnt++;
+	} else {
+		miss_cnt++;
+		e = install (sector);
+	}
+	lock_release (&cache_lock);
+
+	lock_acquire (&e->lock);
+	if (!e->loaded && !overwrite) {
+		disk_read (filesys_disk, sector, e->data);
+		e->loaded = true;
+	}
+	return e;
+}
+
+/* Releases E, obtained from acquire_entry().  DIRTY_DELTA is 1
+ * if the caller set E's dirty bit, -1 if it cleared it, and 0
+ * otherwise. */
+static void
+release_entry (struct cache_entry *e, int dirty_delta) {
+	lock_release (&e->lock);
+
+	lock_acquire (&cache_lock);
+	if (--e->pin_cnt == 0)
+		cond_signal (&cache_unpinned, &cache_lock);
+	dirty_cnt += dirty_delta;
+	if (dirty_delta > 0 && dirty_cnt == 1)
+		cond_signal (&dirty_nonzero, &cache_lock);
+	lock_release (&cache_lock);
+}
+
+/* Sorts the CNT entries in BATCH by sector.  Threads that lock
+ * more than one entry at a time lock them in this order. */
+static void
+sort_by_sector (struct cache_entry **batch, size_t cnt) {
+	size_t i, j;
+
+	for (i = 1; i < cnt; i++) {
+		struct cache_entry *e = batch[i];
+		for (j = i; j > 0 && batch[j - 1]->sector > e->sector; j--)
+			batch[j] = batch[j - 1];
+		batch[j] = e;
+	}
+}
+
+/* Writes back the entries that became dirty no later than tick
+ * CUTOFF, in ascending sector order so that the disk sees one
+ * sweep instead of a seek per sector.  Each run of consecutive
+ * sectors is written with a single request, and all of the
+ * requests are submitted before waiting for any of them. */
+static void
+write_behind (int64_t cutoff) {
+	struct cache_entry *batch[BUFFER_CACHE_SIZE];
+	size_t cnt = 0;
+	size_t req_cnt = 0;
+	size_t i, j;
+
+	lock_acquire (&flush_lock);
+
+	/* Pin the candidates. */
+	lock_acquire (&cache_lock);
+	for (i = 0; i < BUFFER_CACHE_SIZE; i++) {
+		struct cache_entry *e = &cache[i];
+		if (e->in_use && e->dirty && e->dirty_since <= cutoff) {
+			e->pin_cnt++;
+			batch[cnt++] = e;
+		}
+	}
+	lock_release (&cache_lock);
+
+	sort_by_sector (batch, cnt);
+
+	/* An entry that some other thread wrote back in the meantime
+	 * is clean, but pinning kept its data, so writing it again is
+	 * harmless and keeps its run whole.  Each lock is held until
+	 * the write completes, so that no newer write of the same
+	 * sector can overtake it. */
+	for (i = 0; i < cnt; i++) {
+		lock_acquire (&batch[i]->lock);
+		memcpy (flush_buf + i * DISK_SECTOR_SIZE, batch[i]->data,
+				DISK_SECTOR_SIZE);
+	}
+
+	for (i = 0; i < cnt; i = j) {
+		struct disk_req *r = &flush_reqs[req_cnt++];
+
+		for (j = i + 1; j < cnt && j - i < DISK_MULTIPLE_MAX
+				&& batch[j]->sector == batch[j - 1]->sector + 1; j++)
+			continue;
+
+		r->disk = filesys_disk;
+		r->sector = batch[i]->sector;
+		r->cnt = j - i;
+		r->buffer = flush_buf + i * DISK_SECTOR_SIZE;
+		r->write = true;
+		r->complete = NULL;
+		disk_submit (r);
+	}
+	for (i = 0; i < req_cnt; i++)
+		disk_wait (&flush_reqs[i]);
+
+	for (i = 0; i < cnt; i++) {
+		struct cache_entry *e = batch[i];
+		int dirty_delta = e->dirty ? -1 : 0;
+
+		e->dirty = false;
+		release_entry (e, dirty_delta);
+	}
+
+	lock_release (&flush_lock);
+}
+
+/* Reads SIZE bytes starting at byte offset OFS within SECTOR
+ * into BUFFER. */
+void
+buffer_cache_read (disk_sector_t sector, void *buffer, size_t ofs,
+		size_t size) {
+	struct cache_entry *e;
+
+	ASSERT (ofs + size <= DISK_SECTOR_SIZE);
+
+	e = acquire_entry (sector, false);
+	memcpy (buffer, e->data + ofs, size);
+	release_entry (e, 0);
+}
+
+/* Writes SIZE bytes from BUFFER into SECTOR, starting at byte
+ * offset OFS within it.  The data reaches the disk when the
+ * flusher finds it old enough, when the sector is evicted, or
+ * when the cache is flushed.  If too much of the cache is dirty,
+ * first writes it back, so that writers that outpace the disk
+ * are slowed to its speed. */
+void
+buffer_cache_write (disk_sector_t sector, const void *buffer, size_t ofs,
+		size_t size) {
+	struct cache_entry *e;
+	bool throttle;
+	int dirty_delta = 0;
+
+	ASSERT (ofs + size <= DISK_SECTOR_SIZE);
+
+	lock_acquire (&cache_lock);
+	throttle = dirty_cnt >= BUFFER_CACHE_DIRTY_MAX;
+	lock_release (&cache_lock);
+	if (throttle)
+		write_behind (INT64_MAX);
+
+	e = acquire_entry (sector, ofs == 0 && size == DISK_SECTOR_SIZE);
+	memcpy (e->data + ofs, buffer, size);
+	e->loaded = true;
+	if (!e->dirty) {
+		e->dirty = true;
+		e->dirty_since = timer_ticks ();
+		dirty_delta = 1;
+	}
+	release_entry (e, dirty_delta);
+}
+
+/* Asks the read-ahead daemon to load SECTOR into the cache.
+ * Returns without waiting; the request is dropped if the daemon
+ * is too far behind. */
+void
+buffer_cache_readahead (disk_sector_t sector) {
+	lock_acquire (&ra_lock);
+	if (ra_cnt < READAHEAD_QUEUE_SIZE) {
+		ra_queue[(ra_head + ra_cnt) % READAHEAD_QUEUE_SIZE] = sector;
+		ra_cnt++;
+		cond_signal (&ra_nonempty, &ra_lock);
+	}
+	lock_release (&ra_lock);
+}
+
+/* Loads those of the CNT SECTORS that are not already cached.
+ * All of the reads are submitted before waiting for any of them,
+ * so that the disk driver can merge adjacent sectors into one
+ * command and order the rest. */
+static void
+prefetch (const disk_sector_t sectors[], size_t cnt) {
+	struct cache_entry *batch[READAHEAD_BATCH];
+	size_t batch_cnt = 0;
+	size_t pending = 0;
+	size_t i;
+
+	ASSERT (cnt <= READAHEAD_BATCH);
+
+	/* Pin every entry before locking any, since install() may wait
+	 * for other threads to unpin theirs. */
+	lock_acquire (&cache_lock);
+	for (i = 0; i < cnt; i++)
+		if (lookup (sectors[i]) == NULL) {
+			readahead_cnt++;
+			batch[batch_cnt++] = install (sectors[i]);
+		}
+	lock_release (&cache_lock);
+
+	sort_by_sector (batch, batch_cnt);
+	for (i = 0; i < batch_cnt; i++) {
+		struct cache_entry *e = batch[i];
+		struct disk_req *r;
+
+		/* A thread that got here first has loaded it already, or
+		 * written all of it.  Reading the disk now would throw
+		 * away that writer's data, which may not be on disk yet. */
+		lock_acquire (&e->lock);
+		if (e->loaded) {
+			release_entry (e, 0);
+			continue;
+		}
+
+		r = &ra_reqs[pending];
+		batch[pending++] = e;
+		r->disk = filesys_disk;
+		r->sector = e->sector;
+		r->cnt = 1;
+		r->buffer = e->data;
+		r->write = false;
+		r->complete = NULL;
+		disk_submit (r);
+	}
+
+	for (i = 0; i < pending; i++) {
+		disk_wait (&ra_reqs[i]);
+		batch[i]->loaded = true;
+		release_entry (batch[i], 0);
+	}
+}
+
+/* Thread that serves read-ahead requests, up to READAHEAD_BATCH
+ * at a time.  Threads reading the sectors it is loading wait on
+ * the entry lock for the read in flight instead of issuing their
+ * own. */
+static void
+readahead_daemon (void *aux UNUSED) {
+	for (;;) {
+		disk_sector_t sectors[READAHEAD_BATCH];
+		size_t cnt = 0;
+
+		lock_acquire (&ra_lock);
+		while (ra_cnt == 0)
+			cond_wait (&ra_nonempty, &ra_lock);
+		while (ra_cnt > 0 && cnt < READAHEAD_BATCH) {
+			sectors[cnt++] = ra_queue[ra_head];
+			ra_head = (ra_head + 1) % READAHEAD_QUEUE_SIZE;
+			ra_cnt--;
+		}
+		lock_release (&ra_lock);
+
+		prefetch (sectors, cnt);
+	}
+}
+
+/* Thread that writes back sectors that have been dirty for
+ * BUFFER_CACHE_DIRTY_AGE ticks, bounding how much is lost if the
+ * machine stops without filesys_done().  Sleeps while nothing is
+ * dirty, so that an idle system stays idle. */
+static void
+flush_daemon (void *aux UNUSED) {
+	for (;;) {
+		lock_acquire (&cache_lock);
+		while (dirty_cnt == 0)
+			cond_wait (&dirty_nonzero, &cache_lock);
+		lock_release (&cache_lock);
+
+		timer_sleep (BUFFER_CACHE_FLUSH_INTERVAL);
+		write_behind (timer_ticks () - BUFFER_CACHE_DIRTY_AGE);
+	}
+}
+
+/* Writes every dirty sector in the cache back to disk. */
+void
+buffer_cache_flush (void) {
+	write_behind (INT64_MAX);
+}
+
+/* Shuts down the buffer cache, writing back any dirty sectors. */
+void
+buffer_cache_done (void) {
+	buffer_cache_flush ();
+}
+
+/* Prints buffer cache statistics. */
+void
+buffer_cache_print_stats (void) {
+	printf ("Buffer cache: %lld hits, %lld misses, %lld read ahead\n",
+			hit_cnt, miss_cnt, readahead_cnt);
+}
@@ -0,0 +1,159 @@
+/* dcache.c: Cache of directory name lookups.
+
+   Maps a (directory inode sector, name) pair to the sector of the
+   named file's inode, or records that the directory has no such
+   name, so that repeated lookups of the same path do not search
+   the directory at all.  Directory code keeps the cache exact:
+   it fills entries only while holding the directory's lock, and
+   dir_add() and dir_remove() overwrite the entry for the name
+   they change. */
+
+#include "filesys/dcache.h"
+#include <debug.h>
+#include <hash.h>
+#include <list.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/directory.h"
+#include "threads/synch.h"
+
+/* A cached name. */
+struct dcache_entry {
+	disk_sector_t dir;                  /* Directory inode sector. */
+	char name[NAME_MAX + 1];            /* Null terminated file name. */
+	bool present;                       /* Does DIR contain NAME? */
+	disk_sector_t sector;               /* NAME's inode, if PRESENT. */
+	struct hash_elem hash_elem;         /* In names. */
+	struct list_elem lru_elem;          /* In lru, or free_entries. */
+};
+
+static struct dcache_entry entries[DCACHE_SIZE];
+static struct hash names;               /* Cached entries, by key. */
+static struct list lru;                 /* Cached entries, most recent first. */
+static struct list free_entries;        /* Entries not in use. */
+static struct lock dcache_lock;         /* Guards all of the above. */
+
+static long long hit_cnt;               /* Lookups that found a file. */
+static long long neg_hit_cnt;           /* Lookups that found no file. */
+static long long miss_cnt;              /* Lookups not in the cache. */
+
+static uint64_t
+entry_hash (const struct hash_elem *e_, void *aux UNUSED) {
+	const struct dcache_entry *e = hash_entry (e_, struct dcache_entry,
+			hash_elem);
+	return hash_string (e->name) ^ hash_int (e->dir);
+}
+
+static bool
+entry_less (const struct hash_elem *a_, const struct hash_elem *b_,
+		void *aux UNUSED) {
+	const struct dcache_entry *a = hash_entry (a_, struct dcache_entry,
+			hash_elem);
+	const struct dcache_entry *b = hash_entry (b_, struct dcache_entry,
+			hash_elem);
+	if (a->dir != b->dir)
+		return a->dir < b->dir;
+	return strcmp (a->name, b->name) < 0;
+}
+
+/* Initializes the name cache. */
+void
+dcache_init (void) {
+	size_t i;
+
+	lock_init (&dcache_lock);
+	if (!hash_init (&names, entry_hash, entry_less, NULL))
+		PANIC ("name cache initialization failed");
+	list_init (&lru);
+	list_init (&free_entries);
+	for (i = 0; i < DCACHE_SIZE; i++)
+		list_push_back (&free_entries, &entries[i].lru_elem);
+}
+
+/* Returns the cached entry for NAME in DIR, or a null pointer if
+ * there is none.  dcache_lock must be held. */
+static struct dcache_entry *
+find (disk_sector_t dir, const char *name) {
+	struct dcache_entry key;
+	struct hash_elem *e;
+
+	key.dir = dir;
+	strlcpy (key.name, name, sizeof key.name);
+	e = hash_find (&names, &key.hash_elem);
+	return e != NULL ? hash_entry (e, struct dcache_entry, hash_elem) : NULL;
+}
+
+/* Looks up NAME in directory DIR.  Returns DCACHE_PRESENT and
+ * sets *SECTORP to the sector of NAME's inode if DIR is known to
+ * contain NAME, DCACHE_ABSENT if it is known not to, and
+ * DCACHE_MISS otherwise. */
+enum dcache_result
+dcache_lookup (disk_sector_t dir, const char *name, disk_sector_t *sectorp) {
+	struct dcache_entry *e;
+	enum dcache_result result = DCACHE_MISS;
+
+	if (strlen (name) > NAME_MAX)
+		return DCACHE_MISS;
+
+	lock_acquire (&dcache_lock);
+	e = find (dir, name);
+	if (e == NULL)
+		miss_cnt++;
+	else {
+		list_remove (&e->lru_elem);
+		list_push_front (&lru, &e->lru_elem);
+		if (e->present) {
+			hit_cnt++;
+			*sectorp = e->sector;
+			result = DCACHE_PRESENT;
+		} else {
+			neg_hit_cnt++;
+			result = DCACHE_ABSENT;
+		}
+	}
+	lock_release (&dcache_lock);
+	return result;
+}
+
+/* Records that directory DIR contains NAME, whose inode is in
+ * SECTOR, if PRESENT is true, or that it does not contain NAME,
+ * if PRESENT is false, replacing anything cached for NAME.  The
+ * caller must hold DIR's directory lock, for writing if it is
+ * changing DIR. */
+void
+dcache_insert (disk_sector_t dir, const char *name, bool present,
+		disk_sector_t sector) {
+	struct dcache_entry *e;
+
+	if (strlen (name) > NAME_MAX)
+		return;
+
+	lock_acquire (&dcache_lock);
+	e = find (dir, name);
+	if (e != NULL)
+		list_remove (&e->lru_elem);
+	else {
+		if (!list_empty (&free_entries))
+			e = list_entry (list_pop_front (&free_entries),
+					struct dcache_entry, lru_elem);
+		else {
+			e = list_entry (list_pop_back (&lru), struct dcache_entry,
+					lru_elem);
+			hash_delete (&names, &e->hash_elem);
+		}
+		e->dir = dir;
+		strlcpy (e->name, name, sizeof e->name);
+		hash_insert (&names, &e->hash_elem);
+	}
+	e->present = present;
+	e->sector = sector;
+	list_push_front (&lru, &e->lru_elem);
+	lock_release (&dcache_lock);
+}
+
+/* Prints name cache statistics. */
+void
+dcache_print_stats (void) {
+	printf ("Name cache: %lld hits, %lld negative hits, %lld misses\n",
+			hit_cnt, neg_hit_cnt, miss_cnt);
+}
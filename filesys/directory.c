@@ -1,10 +1,14 @@
 #include "filesys/directory.h"
+#include <hash.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include <list.h>
+#include "filesys/dcache.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
 #include "threads/malloc.h"
+#include "threads/synch.h"
 
 /* A directory. */
 struct dir {
@@ -19,6 +23,24 @@ struct dir_entry {
 	bool in_use;                        /* In use or free? */
 };
 
+/* A directory is an array of entries, or "slots", that is
+ * searched linearly while it is small.  Once it grows past
+ * DIR_INDEX_MIN slots it gets a hash index, kept in a separate
+ * file so that slots never move and dir_readdir() order stays
+ * stable.  The index file holds this header, then BUCKET_CNT
+ * chain heads, then one link per slot.  The slots in use are
+ * chained from the head of the bucket their names hash to, and
+ * the free ones from FREE_HEAD.  Each chain ends with NO_SLOT. */
+struct dir_index {
+	uint32_t bucket_cnt;                /* Number of hash buckets. */
+	uint32_t slot_cnt;                  /* Slots that have links. */
+	uint32_t free_head;                 /* First free slot. */
+	uint32_t unused;                    /* Not used. */
+};
+
+#define DIR_INDEX_MIN 32                /* Slots before indexing. */
+#define NO_SLOT UINT32_MAX              /* Ends a chain. */
+
 /* Creates a directory with space for ENTRY_CNT entries in the
  * given SECTOR.  Returns true if successful, false on failure. */
 bool
@@ -71,48 +93,253 @@ dir_get_inode (struct dir *dir) {
 	return dir->inode;
 }
 
+/* Returns the offset within an index file of bucket B's head. */
+static off_t
+head_ofs (uint32_t b) {
+	return sizeof (struct dir_index) + b * sizeof (uint32_t);
+}
+
+/* Returns the offset within the index file with header H of
+ * SLOT's link. */
+static off_t
+link_ofs (const struct dir_index *h, uint32_t slot) {
+	return head_ofs (h->bucket_cnt) + slot * sizeof (uint32_t);
+}
+
+/* Returns the bucket that NAME hashes to in the index with
+ * header H. */
+static uint32_t
+bucket_of (const struct dir_index *h, const char *name) {
+	return hash_string (name) % h->bucket_cnt;
+}
+
+/* Reads the 32-bit value at OFS in INDEX. */
+static uint32_t
+read_u32 (struct inode *index, off_t ofs) {
+	uint32_t v = NO_SLOT;
+
+	inode_read_at (index, &v, sizeof v, ofs);
+	return v;
+}
+
+/* Writes V at OFS in INDEX.  Returns true if successful. */
+static bool
+write_u32 (struct inode *index, off_t ofs, uint32_t v) {
+	return inode_write_at (index, &v, sizeof v, ofs) == sizeof v;
+}
+
+/* Opens DIR's index and reads its header into *H.  Returns the
+ * index, or a null pointer if DIR has none. */
+static struct inode *
+open_index (const struct dir *dir, struct dir_index *h) {
+	disk_sector_t sector = inode_get_dir_index (dir->inode);
+	struct inode *index;
+
+	if (sector == 0)
+		return NULL;
+	index = inode_open (sector);
+	if (index != NULL
+			&& inode_read_at (index, h, sizeof *h, 0) != sizeof *h) {
+		inode_close (index);
+		index = NULL;
+	}
+	return index;
+}
+
+/* Writes a fresh index for DIR with enough buckets for twice its
+ * current number of slots, creating the index file if DIR has
+ * none yet.  DIR's directory lock must be held for writing.
+ * Returns false if memory or disk allocation fails, in which case
+ * DIR's old index, if any, is unchanged. */
+static bool
+build_index (struct dir *dir) {
+	struct dir_index *h;
+	uint32_t *heads, *links;
+	uint32_t bucket_cnt, slot_cnt, slot;
+	disk_sector_t sector;
+	struct inode *index;
+	struct dir_entry e;
+	size_t size;
+	bool success = false;
+
+	slot_cnt = inode_length (dir->inode) / sizeof e;
+	for (bucket_cnt = DIR_INDEX_MIN; bucket_cnt < 2 * slot_cnt; bucket_cnt *= 2)
+		continue;
+
+	size = sizeof *h + (bucket_cnt + slot_cnt) * sizeof (uint32_t);
+	h = malloc (size);
+	if (h == NULL)
+		return false;
+	h->bucket_cnt = bucket_cnt;
+	h->slot_cnt = slot_cnt;
+	h->free_head = NO_SLOT;
+	h->unused = 0;
+	heads = (uint32_t *) (h + 1);
+	links = heads + bucket_cnt;
+	memset (heads, 0xff, bucket_cnt * sizeof *heads);
+
+	/* Push slots onto their chains in reverse, so that each chain
+	 * is in slot order. */
+	for (slot = slot_cnt; slot-- > 0; ) {
+		uint32_t *head = &h->free_head;
+
+		if (inode_read_at (dir->inode, &e, sizeof e, slot * sizeof e)
+				!= sizeof e)
+			goto done;
+		if (e.in_use)
+			head = &heads[bucket_of (h, e.name)];
+		links[slot] = *head;
+		*head = slot;
+	}
+
+	sector = inode_get_dir_index (dir->inode);
+	if (sector == 0) {
+		if (!filesys_alloc_sector (&sector))
+			goto done;
+		if (!inode_create (sector, 0)) {
+			filesys_free_sector (sector);
+			goto done;
+		}
+		inode_set_dir_index (dir->inode, sector);
+	}
+	index = inode_open (sector);
+	if (index != NULL) {
+		success = inode_write_at (index, h, size, 0) == (off_t) size;
+		inode_close (index);
+	}
+
+done:
+	free (h);
+	return success;
+}
+
 /* Searches DIR for a file with the given NAME.
  * If successful, returns true, sets *EP to the directory entry
  * if EP is non-null, and sets *OFSP to the byte offset of the
  * directory entry if OFSP is non-null.
- * otherwise, returns false and ignores EP and OFSP. */
+ * otherwise, returns false and ignores EP and OFSP.
+ * Follows a single hash chain if DIR is indexed. */
 static bool
 lookup (const struct dir *dir, const char *name,
 		struct dir_entry *ep, off_t *ofsp) {
 	struct dir_entry e;
+	struct dir_index h;
+	struct inode *index;
 	size_t ofs;
+	bool found = false;
 
 	ASSERT (dir != NULL);
 	ASSERT (name != NULL);
 
-	for (ofs = 0; inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
-			ofs += sizeof e)
-		if (e.in_use && !strcmp (name, e.name)) {
-			if (ep != NULL)
-				*ep = e;
-			if (ofsp != NULL)
-				*ofsp = ofs;
-			return true;
+	index = open_index (dir, &h);
+	if (index == NULL) {
+		for (ofs = 0; inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
+				ofs += sizeof e)
+			if (e.in_use && !strcmp (name, e.name)) {
+				found = true;
+				break;
+			}
+	} else {
+		uint32_t slot = read_u32 (index, head_ofs (bucket_of (&h, name)));
+
+		for (; slot != NO_SLOT; slot = read_u32 (index, link_ofs (&h, slot))) {
+			ofs = slot * sizeof e;
+			if (inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e
+					&& e.in_use && !strcmp (name, e.name)) {
+				found = true;
+				break;
+			}
 		}
-	return false;
+		inode_close (index);
+	}
+
+	if (found) {
+		if (ep != NULL)
+			*ep = e;
+		if (ofsp != NULL)
+			*ofsp = ofs;
+	}
+	return found;
+}
+
+/* Adds entry E to indexed DIR, whose index is INDEX with header
+ * *H, taking the first free slot or else a new one at the end.
+ * Returns true if successful. */
+static bool
+index_add (struct dir *dir, struct inode *index, struct dir_index *h,
+		const struct dir_entry *e) {
+	off_t head = head_ofs (bucket_of (h, e->name));
+	uint32_t slot = h->free_head;
+
+	if (slot != NO_SLOT)
+		h->free_head = read_u32 (index, link_ofs (h, slot));
+	else
+		slot = h->slot_cnt++;
+
+	return (inode_write_at (dir->inode, e, sizeof *e, slot * sizeof *e)
+				== sizeof *e
+			&& write_u32 (index, link_ofs (h, slot), read_u32 (index, head))
+			&& write_u32 (index, head, slot)
+			&& inode_write_at (index, h, sizeof *h, 0) == sizeof *h);
+}
+
+/* Unlinks the entry named NAME, in slot SLOT, from the hash chain
+ * of indexed DIR, whose index is INDEX with header *H, and puts
+ * SLOT on the free chain.  Returns true if successful. */
+static bool
+index_remove (struct inode *index, struct dir_index *h, const char *name,
+		uint32_t slot) {
+	off_t prev = head_ofs (bucket_of (h, name));
+	uint32_t s;
+
+	/* Find the link that points to SLOT. */
+	while ((s = read_u32 (index, prev)) != slot) {
+		if (s == NO_SLOT)
+			return false;
+		prev = link_ofs (h, s);
+	}
+
+	if (!write_u32 (index, prev, read_u32 (index, link_ofs (h, slot)))
+			|| !write_u32 (index, link_ofs (h, slot), h->free_head))
+		return false;
+	h->free_head = slot;
+	return inode_write_at (index, h, sizeof *h, 0) == sizeof *h;
 }
 
 /* Searches DIR for a file with the given NAME
  * and returns true if one exists, false otherwise.
  * On success, sets *INODE to an inode for the file, otherwise to
- * a null pointer.  The caller must close *INODE. */
+ * a null pointer.  The caller must close *INODE.
+ * Consults the name cache first, and caches what it finds. */
 bool
 dir_lookup (const struct dir *dir, const char *name,
 		struct inode **inode) {
+	disk_sector_t dir_sector = inode_get_inumber (dir->inode);
+	disk_sector_t sector;
 	struct dir_entry e;
 
 	ASSERT (dir != NULL);
 	ASSERT (name != NULL);
 
-	if (lookup (dir, name, &e, NULL))
-		*inode = inode_open (e.inode_sector);
-	else
-		*inode = NULL;
+	rwlock_acquire_read (inode_dir_lock (dir->inode));
+	switch (dcache_lookup (dir_sector, name, &sector)) {
+		case DCACHE_PRESENT:
+			*inode = inode_open (sector);
+			break;
+		case DCACHE_ABSENT:
+			*inode = NULL;
+			break;
+		default:
+			if (lookup (dir, name, &e, NULL)) {
+				dcache_insert (dir_sector, name, true, e.inode_sector);
+				*inode = inode_open (e.inode_sector);
+			} else {
+				dcache_insert (dir_sector, name, false, 0);
+				*inode = NULL;
+			}
+			break;
+	}
+	rwlock_release_read (inode_dir_lock (dir->inode));
 
 	return *inode != NULL;
 }
@@ -125,7 +352,12 @@ dir_lookup (const struct dir *dir, const char *name,
  * error occurs. */
 bool
 dir_add (struct dir *dir, const char *name, disk_sector_t inode_sector) {
-	struct dir_entry e;
+	disk_sector_t dir_sector = inode_get_inumber (dir->inode);
+	disk_sector_t cached_sector;
+	enum dcache_result cached;
+	struct dir_entry e, slot;
+	struct dir_index h;
+	struct inode *index;
 	off_t ofs;
 	bool success = false;
 
@@ -136,10 +368,29 @@ dir_add (struct dir *dir, const char *name, disk_sector_t inode_sector) {
 	if (*name == '\0' || strlen (name) > NAME_MAX)
 		return false;
 
+	rwlock_acquire_write (inode_dir_lock (dir->inode));
+
 	/* Check that NAME is not in use. */
-	if (lookup (dir, name, NULL, NULL))
+	cached = dcache_lookup (dir_sector, name, &cached_sector);
+	if (cached == DCACHE_PRESENT
+			|| (cached == DCACHE_MISS && lookup (dir, name, NULL, NULL)))
 		goto done;
 
+	e.in_use = true;
+	strlcpy (e.name, name, sizeof e.name);
+	e.inode_sector = inode_sector;
+
+	/* An indexed directory finds a free slot through its index,
+	 * and is re-indexed with more buckets when it has doubled. */
+	index = open_index (dir, &h);
+	if (index != NULL) {
+		success = index_add (dir, index, &h, &e);
+		inode_close (index);
+		if (success && h.slot_cnt > h.bucket_cnt)
+			build_index (dir);
+		goto added;
+	}
+
 	/* Set OFS to offset of free slot.
 	 * If there are no free slots, then it will be set to the
 	 * current end-of-file.
@@ -147,18 +398,21 @@ dir_add (struct dir *dir, const char *name, disk_sector_t inode_sector) {
 	 * inode_read_at() will only return a short read at end of file.
 	 * Otherwise, we'd need to verify that we didn't get a short
 	 * read due to something intermittent such as low memory. */
-	for (ofs = 0; inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
-			ofs += sizeof e)
-		if (!e.in_use)
+	for (ofs = 0; inode_read_at (dir->inode, &slot, sizeof slot, ofs)
+			== sizeof slot; ofs += sizeof slot)
+		if (!slot.in_use)
 			break;
 
-	/* Write slot. */
-	e.in_use = true;
-	strlcpy (e.name, name, sizeof e.name);
-	e.inode_sector = inode_sector;
+	/* Write slot, and index the directory once it is large. */
 	success = inode_write_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
+	if (success && inode_length (dir->inode) / sizeof e > DIR_INDEX_MIN)
+		build_index (dir);
 
+added:
+	if (success)
+		dcache_insert (dir_sector, name, true, inode_sector);
 done:
+	rwlock_release_write (inode_dir_lock (dir->inode));
 	return success;
 }
 
@@ -168,13 +422,17 @@ done:
 bool
 dir_remove (struct dir *dir, const char *name) {
 	struct dir_entry e;
+	struct dir_index h;
 	struct inode *inode = NULL;
+	struct inode *index;
 	bool success = false;
 	off_t ofs;
 
 	ASSERT (dir != NULL);
 	ASSERT (name != NULL);
 
+	rwlock_acquire_write (inode_dir_lock (dir->inode));
+
 	/* Find directory entry. */
 	if (!lookup (dir, name, &e, &ofs))
 		goto done;
@@ -184,16 +442,25 @@ dir_remove (struct dir *dir, const char *name) {
 	if (inode == NULL)
 		goto done;
 
-	/* Erase directory entry. */
+	/* Erase directory entry, and free its slot in the index. */
+	index = open_index (dir, &h);
+	if (index != NULL) {
+		bool unlinked = index_remove (index, &h, e.name, ofs / sizeof e);
+		inode_close (index);
+		if (!unlinked)
+			goto done;
+	}
 	e.in_use = false;
 	if (inode_write_at (dir->inode, &e, sizeof e, ofs) != sizeof e)
 		goto done;
 
 	/* Remove inode. */
 	inode_remove (inode);
+	dcache_insert (inode_get_inumber (dir->inode), name, false, 0);
 	success = true;
 
 done:
+	rwlock_release_write (inode_dir_lock (dir->inode));
 	inode_close (inode);
 	return success;
 }
@@ -204,13 +471,17 @@ done:
 bool
 dir_readdir (struct dir *dir, char name[NAME_MAX + 1]) {
 	struct dir_entry e;
+	bool found = false;
 
+	rwlock_acquire_read (inode_dir_lock (dir->inode));
 	while (inode_read_at (dir->inode, &e, sizeof e, dir->pos) == sizeof e) {
 		dir->pos += sizeof e;
 		if (e.in_use) {
 			strlcpy (name, e.name, NAME_MAX + 1);
-			return true;
+			found = true;
+			break;
 		}
 	}
-	return false;
+	rwlock_release_read (inode_dir_lock (dir->inode));
+	return found;
 }
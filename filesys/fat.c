@@ -1,8 +1,11 @@
 #include "filesys/fat.h"
+#include <bitmap.h>
 #include "devices/disk.h"
+#include "devices/timer.h"
 #include "filesys/filesys.h"
 #include "threads/malloc.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
 #include <stdio.h>
 #include <string.h>
 
@@ -22,14 +25,33 @@ struct fat_fs {
 	unsigned int *fat;
 	unsigned int fat_length;
 	disk_sector_t data_start;
-	cluster_t last_clst;
-	struct lock write_lock;
+	cluster_t last_clst;      /* Next-fit cursor: last cluster allocated. */
+	struct bitmap *used;      /* Clusters in use, one bit per FAT entry. */
+	struct bitmap *dirty;     /* FAT sectors changed since last written. */
+	size_t dirty_cnt;         /* Number of bits set in DIRTY. */
+	struct condition dirty_nonzero; /* Signaled when DIRTY_CNT rises. */
+	struct lock write_lock;   /* Guards the table and the bitmaps. */
+	struct lock flush_lock;   /* Serializes fat_flush(). */
 };
 
+/* A new chain, or one whose next cluster is taken, starts in a
+ * free run of at least this many clusters where there is one, so
+ * that a file grown a few clusters at a time has room to stay
+ * contiguous. */
+#define FAT_GROW_RUN 16
+
+/* Dirty FAT sectors are written in runs of up to this many
+ * sectors, copied out of the table here so that allocation can
+ * continue while they are written.  Guarded by flush_lock. */
+#define FAT_FLUSH_RUN 8
+static uint8_t flush_buf[FAT_FLUSH_RUN * DISK_SECTOR_SIZE];
+
 static struct fat_fs *fat_fs;
 
 void fat_boot_create (void);
 void fat_fs_init (void);
+static void fat_build_bitmaps (void);
+static void fat_flush_daemon (void *aux);
 
 void
 fat_init (void) {
@@ -53,31 +75,38 @@ fat_init (void) {
 
 void
 fat_open (void) {
+	free (fat_fs->fat);
 	fat_fs->fat = calloc (fat_fs->fat_length, sizeof (cluster_t));
 	if (fat_fs->fat == NULL)
 		PANIC ("FAT load failed");
 
-	// Load FAT directly from the disk
+	// Load FAT directly from the disk, whole sectors in as few
+	// requests as possible and the partial last sector through a bounce
 	uint8_t *buffer = (uint8_t *) fat_fs->fat;
-	off_t bytes_read = 0;
-	off_t bytes_left = sizeof (fat_fs->fat);
 	const off_t fat_size_in_bytes = fat_fs->fat_length * sizeof (cluster_t);
-	for (unsigned i = 0; i < fat_fs->bs.fat_sectors; i++) {
-		bytes_left = fat_size_in_bytes - bytes_read;
-		if (bytes_left >= DISK_SECTOR_SIZE) {
-			disk_read (filesys_disk, fat_fs->bs.fat_start + i,
-			           buffer + bytes_read);
-			bytes_read += DISK_SECTOR_SIZE;
-		} else {
-			uint8_t *bounce = malloc (DISK_SECTOR_SIZE);
-			if (bounce == NULL)
-				PANIC ("FAT load failed");
-			disk_read (filesys_disk, fat_fs->bs.fat_start + i, bounce);
-			memcpy (buffer + bytes_read, bounce, bytes_left);
-			bytes_read += bytes_left;
-			free (bounce);
-		}
+	unsigned full_sectors = fat_size_in_bytes / DISK_SECTOR_SIZE;
+	if (full_sectors > fat_fs->bs.fat_sectors)
+		full_sectors = fat_fs->bs.fat_sectors;
+	for (unsigned i = 0; i < full_sectors; ) {
+		size_t cnt = full_sectors - i;
+		if (cnt > DISK_MULTIPLE_MAX)
+			cnt = DISK_MULTIPLE_MAX;
+		disk_read_multiple (filesys_disk, fat_fs->bs.fat_start + i,
+		                    buffer + i * DISK_SECTOR_SIZE, cnt);
+		i += cnt;
 	}
+	off_t bytes_left = fat_size_in_bytes - full_sectors * DISK_SECTOR_SIZE;
+	if (bytes_left > 0 && full_sectors < fat_fs->bs.fat_sectors) {
+		uint8_t *bounce = malloc (DISK_SECTOR_SIZE);
+		if (bounce == NULL)
+			PANIC ("FAT load failed");
+		disk_read (filesys_disk, fat_fs->bs.fat_start + full_sectors, bounce);
+		memcpy (buffer + full_sectors * DISK_SECTOR_SIZE, bounce, bytes_left);
+		free (bounce);
+	}
+
+	fat_build_bitmaps ();
+	thread_create ("fatflush", PRI_DEFAULT, fat_flush_daemon, NULL);
 }
 
 void
@@ -90,26 +119,65 @@ fat_close (void) {
 	disk_write (filesys_disk, FAT_BOOT_SECTOR, bounce);
 	free (bounce);
 
-	// Write FAT directly to the disk
-	uint8_t *buffer = (uint8_t *) fat_fs->fat;
-	off_t bytes_wrote = 0;
-	off_t bytes_left = sizeof (fat_fs->fat);
-	const off_t fat_size_in_bytes = fat_fs->fat_length * sizeof (cluster_t);
-	for (unsigned i = 0; i < fat_fs->bs.fat_sectors; i++) {
-		bytes_left = fat_size_in_bytes - bytes_wrote;
-		if (bytes_left >= DISK_SECTOR_SIZE) {
-			disk_write (filesys_disk, fat_fs->bs.fat_start + i,
-			            buffer + bytes_wrote);
-			bytes_wrote += DISK_SECTOR_SIZE;
-		} else {
-			bounce = calloc (1, DISK_SECTOR_SIZE);
-			if (bounce == NULL)
-				PANIC ("FAT close failed");
-			memcpy (bounce, buffer + bytes_wrote, bytes_left);
-			disk_write (filesys_disk, fat_fs->bs.fat_start + i, bounce);
-			bytes_wrote += bytes_left;
-			free (bounce);
+	// Write back the FAT sectors changed since the last flush
+	fat_flush ();
+}
+
+/* Writes the FAT sectors changed since they were last written
+ * back to disk, each run of consecutive ones with a single
+ * request.  Costs time in proportion to the entries changed,
+ * not to the size of the FAT. */
+void
+fat_flush (void) {
+	const size_t table_bytes = fat_fs->fat_length * sizeof (cluster_t);
+	size_t sector = 0;
+
+	lock_acquire (&fat_fs->flush_lock);
+	for (;;) {
+		size_t cnt, ofs, bytes;
+
+		lock_acquire (&fat_fs->write_lock);
+		sector = bitmap_scan (fat_fs->dirty, sector, 1, true);
+		if (sector == BITMAP_ERROR) {
+			lock_release (&fat_fs->write_lock);
+			break;
 		}
+		for (cnt = 1; cnt < FAT_FLUSH_RUN
+				&& sector + cnt < fat_fs->bs.fat_sectors
+				&& bitmap_test (fat_fs->dirty, sector + cnt); cnt++)
+			continue;
+		bitmap_set_multiple (fat_fs->dirty, sector, cnt, false);
+		fat_fs->dirty_cnt -= cnt;
+
+		/* The last sectors may extend past the end of the table. */
+		ofs = sector * DISK_SECTOR_SIZE;
+		bytes = ofs < table_bytes ? table_bytes - ofs : 0;
+		if (bytes > cnt * DISK_SECTOR_SIZE)
+			bytes = cnt * DISK_SECTOR_SIZE;
+		memcpy (flush_buf, (uint8_t *) fat_fs->fat + ofs, bytes);
+		memset (flush_buf + bytes, 0, cnt * DISK_SECTOR_SIZE - bytes);
+		lock_release (&fat_fs->write_lock);
+
+		disk_write_multiple (filesys_disk, fat_fs->bs.fat_start + sector,
+		                     flush_buf, cnt);
+		sector += cnt;
+	}
+	lock_release (&fat_fs->flush_lock);
+}
+
+/* Thread that writes back dirty FAT sectors every
+ * FAT_FLUSH_INTERVAL ticks, so that a crash loses at most that
+ * much allocation state.  Sleeps while nothing is dirty. */
+static void
+fat_flush_daemon (void *aux UNUSED) {
+	for (;;) {
+		lock_acquire (&fat_fs->write_lock);
+		while (fat_fs->dirty_cnt == 0)
+			cond_wait (&fat_fs->dirty_nonzero, &fat_fs->write_lock);
+		lock_release (&fat_fs->write_lock);
+
+		timer_sleep (FAT_FLUSH_INTERVAL);
+		fat_flush ();
 	}
 }
 
@@ -123,6 +191,11 @@ fat_create (void) {
 	fat_fs->fat = calloc (fat_fs->fat_length, sizeof (cluster_t));
 	if (fat_fs->fat == NULL)
 		PANIC ("FAT creation failed");
+	fat_build_bitmaps ();
+
+	// The whole table is new, so all of it must be written
+	bitmap_set_all (fat_fs->dirty, true);
+	fat_fs->dirty_cnt = fat_fs->bs.fat_sectors;
 
 	// Set up ROOT_DIR_CLST
 	fat_put (ROOT_DIR_CLUSTER, EOChain);
@@ -152,7 +225,71 @@ fat_boot_create (void) {
 
 void
 fat_fs_init (void) {
-	/* TODO: Your code goes here. */
+	/* The data region follows the FAT.  Cluster 0 is never used, so
+	 * that a FAT entry of 0 can mean "free". */
+	fat_fs->data_start = fat_fs->bs.fat_start + fat_fs->bs.fat_sectors;
+	fat_fs->fat_length = (fat_fs->bs.total_sectors - fat_fs->data_start)
+	                     / SECTORS_PER_CLUSTER + 1;
+	if (fat_fs->fat_length > fat_fs->bs.fat_sectors * FAT_ENTRIES_PER_SECTOR)
+		fat_fs->fat_length = fat_fs->bs.fat_sectors * FAT_ENTRIES_PER_SECTOR;
+	fat_fs->last_clst = ROOT_DIR_CLUSTER;
+	cond_init (&fat_fs->dirty_nonzero);
+	lock_init (&fat_fs->write_lock);
+	lock_init (&fat_fs->flush_lock);
+}
+
+/* Rebuilds the in-use bitmap from the FAT, and starts with no
+ * FAT sector dirty.  Cluster 0 is marked in use so that it is
+ * never handed out. */
+static void
+fat_build_bitmaps (void) {
+	cluster_t i;
+
+	if (fat_fs->used != NULL)
+		bitmap_destroy (fat_fs->used);
+	if (fat_fs->dirty != NULL)
+		bitmap_destroy (fat_fs->dirty);
+	fat_fs->used = bitmap_create (fat_fs->fat_length);
+	fat_fs->dirty = bitmap_create (fat_fs->bs.fat_sectors);
+	if (fat_fs->used == NULL || fat_fs->dirty == NULL)
+		PANIC ("FAT bitmap creation failed");
+	fat_fs->dirty_cnt = 0;
+	bitmap_mark (fat_fs->used, 0);
+	for (i = 1; i < fat_fs->fat_length; i++)
+		if (fat_fs->fat[i] != 0)
+			bitmap_mark (fat_fs->used, i);
+}
+
+/* Marks the FAT sector holding CLST's entry dirty.  write_lock
+ * must be held. */
+static void
+mark_dirty (cluster_t clst) {
+	size_t sector = clst / FAT_ENTRIES_PER_SECTOR;
+
+	if (!bitmap_test (fat_fs->dirty, sector)) {
+		bitmap_mark (fat_fs->dirty, sector);
+		if (fat_fs->dirty_cnt++ == 0)
+			cond_signal (&fat_fs->dirty_nonzero, &fat_fs->write_lock);
+	}
+}
+
+/* Returns the first free cluster at or after the next-fit cursor,
+ * wrapping around, that starts a free run of FAT_GROW_RUN
+ * clusters, or failing that any free cluster.  Returns 0 if the
+ * disk is full.  write_lock must be held. */
+static cluster_t
+find_free_cluster (void) {
+	size_t cnt;
+
+	for (cnt = FAT_GROW_RUN; ; cnt = 1) {
+		size_t clst = bitmap_scan (fat_fs->used, fat_fs->last_clst, cnt, false);
+		if (clst == BITMAP_ERROR)
+			clst = bitmap_scan (fat_fs->used, 0, cnt, false);
+		if (clst != BITMAP_ERROR)
+			return clst;
+		if (cnt == 1)
+			return 0;
+	}
 }
 
 /*----------------------------------------------------------------------------*/
@@ -164,30 +301,93 @@ fat_fs_init (void) {
  * Returns 0 if fails to allocate a new cluster. */
 cluster_t
 fat_create_chain (cluster_t clst) {
-	/* TODO: Your code goes here. */
+	cluster_t new_clst;
+
+	ASSERT (clst < fat_fs->fat_length);
+
+	lock_acquire (&fat_fs->write_lock);
+
+	/* Extend a chain into the cluster right after its tail when
+	 * that is free, so the file stays contiguous on disk. */
+	if (clst != 0 && clst + 1 < fat_fs->fat_length
+			&& !bitmap_test (fat_fs->used, clst + 1))
+		new_clst = clst + 1;
+	else
+		new_clst = find_free_cluster ();
+
+	if (new_clst != 0) {
+		bitmap_mark (fat_fs->used, new_clst);
+		fat_fs->last_clst = new_clst;
+		fat_fs->fat[new_clst] = EOChain;
+		mark_dirty (new_clst);
+		if (clst != 0) {
+			fat_fs->fat[clst] = new_clst;
+			mark_dirty (clst);
+		}
+	}
+	lock_release (&fat_fs->write_lock);
+	return new_clst;
 }
 
 /* Remove the chain of clusters starting from CLST.
  * If PCLST is 0, assume CLST as the start of the chain. */
 void
 fat_remove_chain (cluster_t clst, cluster_t pclst) {
-	/* TODO: Your code goes here. */
+	lock_acquire (&fat_fs->write_lock);
+	if (pclst != 0) {
+		ASSERT (fat_fs->fat[pclst] == clst);
+		fat_fs->fat[pclst] = EOChain;
+		mark_dirty (pclst);
+	}
+	while (clst != EOChain) {
+		cluster_t next;
+
+		ASSERT (clst != 0 && clst < fat_fs->fat_length);
+		next = fat_fs->fat[clst];
+		fat_fs->fat[clst] = 0;
+		bitmap_reset (fat_fs->used, clst);
+		mark_dirty (clst);
+		clst = next;
+	}
+	lock_release (&fat_fs->write_lock);
 }
 
 /* Update a value in the FAT table. */
 void
 fat_put (cluster_t clst, cluster_t val) {
-	/* TODO: Your code goes here. */
+	ASSERT (clst != 0 && clst < fat_fs->fat_length);
+
+	lock_acquire (&fat_fs->write_lock);
+	fat_fs->fat[clst] = val;
+	bitmap_set (fat_fs->used, clst, val != 0);
+	mark_dirty (clst);
+	lock_release (&fat_fs->write_lock);
 }
 
-/* Fetch a value in the FAT table. */
+/* Fetch a value in the FAT table.  Entries are aligned words, so
+ * a reader sees either the old or the new value of one that is
+ * being changed. */
 cluster_t
 fat_get (cluster_t clst) {
-	/* TODO: Your code goes here. */
+	ASSERT (clst != 0 && clst < fat_fs->fat_length);
+
+	return fat_fs->fat[clst];
 }
 
 /* Covert a cluster # to a sector number. */
 disk_sector_t
 cluster_to_sector (cluster_t clst) {
-	/* TODO: Your code goes here. */
+	ASSERT (clst != 0 && clst < fat_fs->fat_length);
+
+	return fat_fs->data_start + (clst - 1) * SECTORS_PER_CLUSTER;
+}
+
+/* Converts SECTOR, the first sector of a cluster, to its
+ * cluster #. */
+cluster_t
+sector_to_cluster (disk_sector_t sector) {
+	ASSERT (sector >= fat_fs->data_start);
+	ASSERT ((sector - fat_fs->data_start) % SECTORS_PER_CLUSTER == 0);
+
+	return (sector - fat_fs->data_start) / SECTORS_PER_CLUSTER + 1;
 }
@@ -1,13 +1,22 @@
 #include "filesys/file.h"
 #include <debug.h>
+#include "devices/disk.h"
 #include "filesys/inode.h"
 #include "threads/malloc.h"
 
+/* Read-ahead window bounds, in sectors. */
+#define RA_MIN_SECTORS 4
+#define RA_MAX_SECTORS 16
+
 /* An open file. */
 struct file {
 	struct inode *inode;        /* File's inode. */
 	off_t pos;                  /* Current position. */
 	bool deny_write;            /* Has file_deny_write() been called? */
+
+	off_t ra_next;              /* Where a sequential read would start. */
+	off_t ra_end;               /* End of the range read ahead so far. */
+	int ra_window;              /* Sectors to read ahead, 0 if random. */
 };
 
 /* Opens a file for the given INODE, of which it takes ownership,
@@ -20,6 +29,9 @@ file_open (struct inode *inode) {
 		file->inode = inode;
 		file->pos = 0;
 		file->deny_write = false;
+		file->ra_next = 0;
+		file->ra_end = 0;
+		file->ra_window = 0;
 		return file;
 	} else {
 		inode_close (inode);
@@ -64,6 +76,34 @@ file_get_inode (struct file *file) {
 	return file->inode;
 }
 
+/* Notes that SIZE bytes of FILE were just read at OFS.  If the
+ * read continued the previous one, grows the read-ahead window
+ * (doubling it up to RA_MAX_SECTORS) and asks for the part of it
+ * not yet requested; otherwise drops the window, so random access
+ * does not pollute the buffer cache. */
+static void
+file_readahead (struct file *file, off_t ofs, off_t size) {
+	off_t start, end;
+
+	if (ofs != file->ra_next) {
+		file->ra_window = 0;
+		file->ra_end = 0;
+	} else if (file->ra_window == 0)
+		file->ra_window = RA_MIN_SECTORS;
+	else if (file->ra_window < RA_MAX_SECTORS)
+		file->ra_window *= 2;
+	file->ra_next = ofs + size;
+
+	if (file->ra_window == 0)
+		return;
+	start = file->ra_end > file->ra_next ? file->ra_end : file->ra_next;
+	end = file->ra_next + file->ra_window * DISK_SECTOR_SIZE;
+	if (start < end) {
+		inode_readahead (file->inode, end - start, start);
+		file->ra_end = end;
+	}
+}
+
 /* Reads SIZE bytes from FILE into BUFFER,
  * starting at the file's current position.
  * Returns the number of bytes actually read,
@@ -72,6 +112,7 @@ file_get_inode (struct file *file) {
 off_t
 file_read (struct file *file, void *buffer, off_t size) {
 	off_t bytes_read = inode_read_at (file->inode, buffer, size, file->pos);
+	file_readahead (file, file->pos, bytes_read);
 	file->pos += bytes_read;
 	return bytes_read;
 }
@@ -2,6 +2,8 @@
 #include <debug.h>
 #include <stdio.h>
 #include <string.h>
+#include "filesys/buffer_cache.h"
+#include "filesys/dcache.h"
 #include "filesys/file.h"
 #include "filesys/free-map.h"
 #include "filesys/inode.h"
@@ -21,7 +23,9 @@ filesys_init (bool format) {
 	if (filesys_disk == NULL)
 		PANIC ("hd0:1 (hdb) not present, file system initialization failed");
 
+	buffer_cache_init ();
 	inode_init ();
+	dcache_init ();
 
 #ifdef EFILESYS
 	fat_init ();
@@ -51,6 +55,7 @@ filesys_done (void) {
 #else
 	free_map_close ();
 #endif
+	buffer_cache_done ();
 }
 
 /* Creates a file named NAME with the given INITIAL_SIZE.
@@ -62,11 +67,11 @@ filesys_create (const char *name, off_t initial_size) {
 	disk_sector_t inode_sector = 0;
 	struct dir *dir = dir_open_root ();
 	bool success = (dir != NULL
-			&& free_map_allocate (1, &inode_sector)
+			&& filesys_alloc_sector (&inode_sector)
 			&& inode_create (inode_sector, initial_size)
 			&& dir_add (dir, name, inode_sector));
 	if (!success && inode_sector != 0)
-		free_map_release (inode_sector, 1);
+		filesys_free_sector (inode_sector);
 	dir_close (dir);
 
 	return success;
@@ -102,6 +107,32 @@ filesys_remove (const char *name) {
 	return success;
 }
 
+/* Allocates a sector to hold a new inode and stores it into
+ * *SECTORP.  Returns true if successful, false if the disk is
+ * full. */
+bool
+filesys_alloc_sector (disk_sector_t *sectorp) {
+#ifdef EFILESYS
+	cluster_t clst = fat_create_chain (0);
+	if (clst == 0)
+		return false;
+	*sectorp = cluster_to_sector (clst);
+	return true;
+#else
+	return free_map_allocate (1, sectorp);
+#endif
+}
+
+/* Frees SECTOR, which was allocated by filesys_alloc_sector(). */
+void
+filesys_free_sector (disk_sector_t sector) {
+#ifdef EFILESYS
+	fat_remove_chain (sector_to_cluster (sector), 0);
+#else
+	free_map_release (sector, 1);
+#endif
+}
+
 /* Formats the file system. */
 static void
 do_format (void) {
@@ -110,6 +141,8 @@ do_format (void) {
 #ifdef EFILESYS
 	/* Create FAT and save it to the disk. */
 	fat_create ();
+	if (!dir_create (ROOT_DIR_SECTOR, 16))
+		PANIC ("root directory creation failed");
 	fat_close ();
 #else
 	free_map_create ();
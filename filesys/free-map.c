@@ -4,13 +4,16 @@
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
+#include "threads/synch.h"
 
 static struct file *free_map_file;   /* Free map file. */
 static struct bitmap *free_map;      /* Free map, one bit per disk sector. */
+static struct lock free_map_lock;    /* Guards both of the above. */
 
 /* Initializes the free map. */
 void
 free_map_init (void) {
+	lock_init (&free_map_lock);
 	free_map = bitmap_create (disk_size (filesys_disk));
 	if (free_map == NULL)
 		PANIC ("bitmap creation failed--disk is too large");
@@ -24,24 +27,53 @@ free_map_init (void) {
  * available. */
 bool
 free_map_allocate (size_t cnt, disk_sector_t *sectorp) {
-	disk_sector_t sector = bitmap_scan_and_flip (free_map, 0, cnt, false);
+	disk_sector_t sector;
+
+	lock_acquire (&free_map_lock);
+	sector = bitmap_scan_and_flip (free_map, 0, cnt, false);
 	if (sector != BITMAP_ERROR
 			&& free_map_file != NULL
 			&& !bitmap_write (free_map, free_map_file)) {
 		bitmap_set_multiple (free_map, sector, cnt, false);
 		sector = BITMAP_ERROR;
 	}
+	lock_release (&free_map_lock);
 	if (sector != BITMAP_ERROR)
 		*sectorp = sector;
 	return sector != BITMAP_ERROR;
 }
 
+/* Allocates up to CNT free sectors that directly follow one
+ * another starting at SECTOR, stopping at the first one in use.
+ * Returns the number allocated, which is 0 if SECTOR itself is
+ * in use. */
+size_t
+free_map_extend (disk_sector_t sector, size_t cnt) {
+	size_t size, n = 0;
+
+	lock_acquire (&free_map_lock);
+	size = bitmap_size (free_map);
+	while (n < cnt && sector + n < size && !bitmap_test (free_map, sector + n))
+		n++;
+	if (n > 0) {
+		bitmap_set_multiple (free_map, sector, n, true);
+		if (free_map_file != NULL && !bitmap_write (free_map, free_map_file)) {
+			bitmap_set_multiple (free_map, sector, n, false);
+			n = 0;
+		}
+	}
+	lock_release (&free_map_lock);
+	return n;
+}
+
 /* Makes CNT sectors starting at SECTOR available for use. */
 void
 free_map_release (disk_sector_t sector, size_t cnt) {
+	lock_acquire (&free_map_lock);
 	ASSERT (bitmap_all (free_map, sector, cnt));
 	bitmap_set_multiple (free_map, sector, cnt, false);
 	bitmap_write (free_map, free_map_file);
+	lock_release (&free_map_lock);
 }
 
 /* Opens the free map file and reads it from disk. */
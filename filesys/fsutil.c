@@ -1,5 +1,6 @@
 #include "filesys/fsutil.h"
 #include <debug.h>
+#include <round.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -11,6 +12,11 @@
 #include "threads/palloc.h"
 #include "threads/vaddr.h"
 
+/* Pages of buffer used to copy between the scratch disk and the
+ * file system. */
+#define COPY_PAGES 8
+#define COPY_SIZE (COPY_PAGES * PGSIZE)
+
 /* List files in the root directory. */
 void
 fsutil_ls (char **argv UNUSED) {
@@ -87,7 +93,7 @@ fsutil_put (char **argv) {
 	printf ("Putting '%s' into the file system...\n", file_name);
 
 	/* Allocate buffer. */
-	buffer = malloc (DISK_SECTOR_SIZE);
+	buffer = palloc_get_multiple (0, COPY_PAGES);
 	if (buffer == NULL)
 		PANIC ("couldn't allocate buffer");
 
@@ -111,10 +117,12 @@ fsutil_put (char **argv) {
 	if (dst == NULL)
 		PANIC ("%s: open failed", file_name);
 
-	/* Do copy. */
+	/* Do copy, reading as many sectors at a time as fit. */
 	while (size > 0) {
-		int chunk_size = size > DISK_SECTOR_SIZE ? DISK_SECTOR_SIZE : size;
-		disk_read (src, sector++, buffer);
+		int chunk_size = size > COPY_SIZE ? COPY_SIZE : size;
+		size_t sector_cnt = DIV_ROUND_UP (chunk_size, DISK_SECTOR_SIZE);
+		disk_read_multiple (src, sector, buffer, sector_cnt);
+		sector += sector_cnt;
 		if (file_write (dst, buffer, chunk_size) != chunk_size)
 			PANIC ("%s: write failed with %"PROTd" bytes unwritten",
 					file_name, size);
@@ -123,7 +131,7 @@ fsutil_put (char **argv) {
 
 	/* Finish up. */
 	file_close (dst);
-	free (buffer);
+	palloc_free_multiple (buffer, COPY_PAGES);
 }
 
 /* Copies file FILE_NAME from the file system to the scratch disk.
@@ -150,7 +158,7 @@ fsutil_get (char **argv) {
 	printf ("Getting '%s' from the file system...\n", file_name);
 
 	/* Allocate buffer. */
-	buffer = malloc (DISK_SECTOR_SIZE);
+	buffer = palloc_get_multiple (0, COPY_PAGES);
 	if (buffer == NULL)
 		PANIC ("couldn't allocate buffer");
 
@@ -171,19 +179,22 @@ fsutil_get (char **argv) {
 	((int32_t *) buffer)[1] = size;
 	disk_write (dst, sector++, buffer);
 
-	/* Do copy. */
+	/* Do copy, writing as many sectors at a time as fit. */
 	while (size > 0) {
-		int chunk_size = size > DISK_SECTOR_SIZE ? DISK_SECTOR_SIZE : size;
-		if (sector >= disk_size (dst))
+		int chunk_size = size > COPY_SIZE ? COPY_SIZE : size;
+		size_t sector_cnt = DIV_ROUND_UP (chunk_size, DISK_SECTOR_SIZE);
+		if (sector + sector_cnt > disk_size (dst))
 			PANIC ("%s: out of space on scratch disk", file_name);
 		if (file_read (src, buffer, chunk_size) != chunk_size)
 			PANIC ("%s: read failed with %"PROTd" bytes unread", file_name, size);
-		memset (buffer + chunk_size, 0, DISK_SECTOR_SIZE - chunk_size);
-		disk_write (dst, sector++, buffer);
+		memset (buffer + chunk_size, 0,
+				sector_cnt * DISK_SECTOR_SIZE - chunk_size);
+		disk_write_multiple (dst, sector, buffer, sector_cnt);
+		sector += sector_cnt;
 		size -= chunk_size;
 	}
 
 	/* Finish up. */
 	file_close (src);
-	free (buffer);
+	palloc_free_multiple (buffer, COPY_PAGES);
 }
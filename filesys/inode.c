@@ -1,23 +1,74 @@
 #include "filesys/inode.h"
+#include <hash.h>
 #include <list.h>
 #include <debug.h>
 #include <round.h>
+#include <stdio.h>
 #include <string.h>
+#include "filesys/buffer_cache.h"
+#include "filesys/fat.h"
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
 #include "threads/malloc.h"
+#include "threads/synch.h"
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
 
+#ifdef EFILESYS
+/* On-disk inode.  The file's data is the FAT chain that starts
+ * at cluster START.
+ * Must be exactly DISK_SECTOR_SIZE bytes long. */
+struct inode_disk {
+	cluster_t start;                    /* First data cluster, or 0. */
+	off_t length;                       /* File size in bytes. */
+	unsigned magic;                     /* Magic number. */
+	uint32_t clst_cnt;                  /* Clusters in the chain. */
+	disk_sector_t dir_index;            /* Directory's index inode, or 0. */
+	uint32_t unused[123];               /* Not used. */
+};
+
+/* Number of bytes in a cluster. */
+#define CLUSTER_BYTES (SECTORS_PER_CLUSTER * DISK_SECTOR_SIZE)
+
+/* LENGTH clusters, starting at START, that follow one another
+ * both in a file's FAT chain and on disk.  START is cluster OFS
+ * of the file. */
+struct cluster_run {
+	uint32_t ofs;                       /* Index within the file. */
+	cluster_t start;                    /* First cluster. */
+	uint32_t length;                    /* Number of clusters. */
+};
+#else
+/* A run of LENGTH consecutive data sectors starting at START. */
+struct extent {
+	disk_sector_t start;                /* First sector. */
+	uint32_t length;                    /* Number of sectors. */
+};
+
+/* A file's extents are kept in file order: the first
+ * INLINE_EXTENTS in the inode itself, the rest in up to
+ * INDIRECT_BLOCKS indirect blocks of EXTENTS_PER_BLOCK each.
+ * Files are allocated in as few extents as the free map allows,
+ * so most never need an indirect block. */
+#define INLINE_EXTENTS 59
+#define INDIRECT_BLOCKS 4
+#define EXTENTS_PER_BLOCK (DISK_SECTOR_SIZE / sizeof (struct extent))
+#define MAX_EXTENTS (INLINE_EXTENTS + INDIRECT_BLOCKS * EXTENTS_PER_BLOCK)
+
 /* On-disk inode.
  * Must be exactly DISK_SECTOR_SIZE bytes long. */
 struct inode_disk {
-	disk_sector_t start;                /* First data sector. */
 	off_t length;                       /* File size in bytes. */
 	unsigned magic;                     /* Magic number. */
-	uint32_t unused[125];               /* Not used. */
+	uint32_t extent_cnt;                /* Number of extents in use. */
+	uint32_t sector_cnt;                /* Data sectors in all extents. */
+	disk_sector_t indirect[INDIRECT_BLOCKS]; /* Blocks of more extents. */
+	struct extent extents[INLINE_EXTENTS];   /* First extents. */
+	disk_sector_t dir_index;            /* Directory's index inode, or 0. */
+	uint32_t unused;                    /* Not used. */
 };
+#endif
 
 /* Returns the number of sectors to allocate for an inode SIZE
  * bytes long. */
@@ -26,37 +77,419 @@ bytes_to_sectors (off_t size) {
 	return DIV_ROUND_UP (size, DISK_SECTOR_SIZE);
 }
 
-/* In-memory inode. */
+/* In-memory inode.
+ * ELEM, OPEN_CNT and REMOVED are protected by open_inodes_lock;
+ * DENY_WRITE_CNT, DATA and the file contents by LOCK, which reads
+ * share and writes hold exclusively. */
 struct inode {
-	struct list_elem elem;              /* Element in inode list. */
+	union {
+		struct hash_elem elem;          /* In open_inodes, while open. */
+		struct list_elem free_elem;     /* In inode_slab, once closed. */
+	};
 	disk_sector_t sector;               /* Sector number of disk location. */
 	int open_cnt;                       /* Number of openers. */
 	bool removed;                       /* True if deleted, false otherwise. */
 	int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
+	struct rwlock lock;                 /* Guards data and contents. */
+	struct rwlock dir_lock;             /* Guards entries, if a directory. */
 	struct inode_disk data;             /* Inode content. */
+#ifdef EFILESYS
+	/* Map of the FAT chain, built as far as it has been needed,
+	 * so that finding a cluster is a binary search instead of a
+	 * walk from the start of the chain. */
+	struct lock map_lock;               /* Guards the members below. */
+	struct cluster_run *runs;           /* Runs, in file order. */
+	size_t run_cnt;                     /* Number of runs. */
+	size_t run_cap;                     /* Allocated length of RUNS. */
+#endif
 };
 
+/* Statistics on file data allocation, guarded by stats_lock. */
+static struct lock stats_lock;
+static long long alloc_sector_cnt;      /* Data sectors allocated. */
+static long long alloc_extent_cnt;      /* Runs of them not contiguous
+                                           with the one before. */
+
+/* Records that CNT data sectors were added to a file, starting a
+ * new extent if NEW_EXTENT is true. */
+static void
+count_alloc (size_t cnt, bool new_extent) {
+	lock_acquire (&stats_lock);
+	alloc_sector_cnt += cnt;
+	if (new_extent)
+		alloc_extent_cnt++;
+	lock_release (&stats_lock);
+}
+
+#ifdef EFILESYS
+/* Appends a run of one cluster, CLST, which is cluster OFS of
+ * INODE's file, to INODE's map.
+ * Returns false if memory allocation fails. */
+static bool
+add_run (struct inode *inode, uint32_t ofs, cluster_t clst) {
+	struct cluster_run *r;
+
+	if (inode->run_cnt == inode->run_cap) {
+		size_t cap = inode->run_cap > 0 ? inode->run_cap * 2 : 4;
+		struct cluster_run *runs = realloc (inode->runs, cap * sizeof *runs);
+		if (runs == NULL)
+			return false;
+		inode->runs = runs;
+		inode->run_cap = cap;
+	}
+	r = &inode->runs[inode->run_cnt++];
+	r->ofs = ofs;
+	r->start = clst;
+	r->length = 1;
+	return true;
+}
+
+/* Follows INODE's FAT chain from the end of its map until the
+ * map covers cluster IDX of the file or the chain ends.  Appended
+ * clusters extend the chain past the end of the map, so the map
+ * never goes stale.
+ * Returns false if memory allocation fails. */
+static bool
+map_chain (struct inode *inode, uint32_t idx) {
+	if (inode->run_cnt == 0) {
+		if (inode->data.start == 0)
+			return true;
+		if (!add_run (inode, 0, inode->data.start))
+			return false;
+	}
+
+	for (;;) {
+		struct cluster_run *last = &inode->runs[inode->run_cnt - 1];
+		cluster_t end = last->start + last->length;
+		cluster_t next;
+
+		if (idx < last->ofs + last->length)
+			return true;
+		next = fat_get (end - 1);
+		if (next == EOChain)
+			return true;
+		if (next == end)
+			last->length++;
+		else if (!add_run (inode, last->ofs + last->length, next))
+			return false;
+	}
+}
+
+/* Returns cluster IDX of INODE's file, or 0 if the file has
+ * fewer clusters. */
+static cluster_t
+file_cluster (struct inode *inode, uint32_t idx) {
+	cluster_t clst = 0;
+
+	lock_acquire (&inode->map_lock);
+	if (map_chain (inode, idx)) {
+		size_t lo = 0, hi = inode->run_cnt;
+
+		while (lo < hi) {
+			size_t mid = (lo + hi) / 2;
+			const struct cluster_run *r = &inode->runs[mid];
+
+			if (idx < r->ofs)
+				hi = mid;
+			else if (idx >= r->ofs + r->length)
+				lo = mid + 1;
+			else {
+				clst = r->start + (idx - r->ofs);
+				break;
+			}
+		}
+	} else {
+		/* Out of memory: walk the rest of the way. */
+		uint32_t ofs = 0;
+
+		clst = inode->data.start;
+		if (inode->run_cnt > 0) {
+			const struct cluster_run *last = &inode->runs[inode->run_cnt - 1];
+
+			ofs = last->ofs + last->length - 1;
+			clst = last->start + last->length - 1;
+		}
+		for (; ofs < idx && clst != EOChain; ofs++)
+			clst = fat_get (clst);
+		if (clst == EOChain)
+			clst = 0;
+	}
+	lock_release (&inode->map_lock);
+	return clst;
+}
+
 /* Returns the disk sector that contains byte offset POS within
  * INODE.
  * Returns -1 if INODE does not contain data for a byte at offset
  * POS. */
 static disk_sector_t
-byte_to_sector (const struct inode *inode, off_t pos) {
+byte_to_sector (struct inode *inode, off_t pos) {
+	cluster_t clst;
+
 	ASSERT (inode != NULL);
-	if (pos < inode->data.length)
-		return inode->data.start + pos / DISK_SECTOR_SIZE;
-	else
+	if (pos >= inode->data.length)
 		return -1;
+
+	clst = file_cluster (inode, pos / CLUSTER_BYTES);
+	ASSERT (clst != 0);
+	return cluster_to_sector (clst) + pos % CLUSTER_BYTES / DISK_SECTOR_SIZE;
+}
+
+/* Returns the number of bytes the file described by DATA can
+ * hold without allocating more clusters. */
+static off_t
+capacity (const struct inode_disk *data) {
+	return (off_t) data->clst_cnt * CLUSTER_BYTES;
+}
+
+/* Adds zeroed clusters to the end of the file described by DATA
+ * until it can hold LENGTH bytes.  INODE is DATA's in-memory
+ * inode, or a null pointer if it has none yet.
+ * Returns false if the disk fills up first, leaving the clusters
+ * added so far in place. */
+static bool
+extend (struct inode_disk *data, struct inode *inode, off_t length) {
+	static char zeros[DISK_SECTOR_SIZE];
+	size_t want = DIV_ROUND_UP (length, CLUSTER_BYTES);
+	cluster_t tail = 0;
+
+	if (data->clst_cnt > 0) {
+		ASSERT (inode != NULL);
+		tail = file_cluster (inode, data->clst_cnt - 1);
+	}
+
+	while (data->clst_cnt < want) {
+		cluster_t clst = fat_create_chain (tail);
+		size_t i;
+
+		if (clst == 0)
+			return false;
+		if (tail == 0)
+			data->start = clst;
+		count_alloc (SECTORS_PER_CLUSTER, tail == 0 || clst != tail + 1);
+		for (i = 0; i < SECTORS_PER_CLUSTER; i++)
+			buffer_cache_write (cluster_to_sector (clst) + i, zeros, 0,
+					DISK_SECTOR_SIZE);
+		data->clst_cnt++;
+		tail = clst;
+	}
+	return true;
+}
+
+/* Frees all of the clusters of the file described by DATA. */
+static void
+release_sectors (struct inode_disk *data) {
+	if (data->start != 0)
+		fat_remove_chain (data->start, 0);
+}
+#else
+
+/* Reads extent IDX of the file described by DATA into *E. */
+static void
+get_extent (const struct inode_disk *data, size_t idx, struct extent *e) {
+	ASSERT (idx < data->extent_cnt);
+
+	if (idx < INLINE_EXTENTS)
+		*e = data->extents[idx];
+	else {
+		idx -= INLINE_EXTENTS;
+		buffer_cache_read (data->indirect[idx / EXTENTS_PER_BLOCK], e,
+				idx % EXTENTS_PER_BLOCK * sizeof *e, sizeof *e);
+	}
+}
+
+/* Sets extent IDX of the file described by DATA to *E.  An
+ * indirect block is written through the buffer cache; the inode
+ * itself is only changed in memory. */
+static void
+set_extent (struct inode_disk *data, size_t idx, const struct extent *e) {
+	ASSERT (idx < data->extent_cnt);
+
+	if (idx < INLINE_EXTENTS)
+		data->extents[idx] = *e;
+	else {
+		idx -= INLINE_EXTENTS;
+		buffer_cache_write (data->indirect[idx / EXTENTS_PER_BLOCK], e,
+				idx % EXTENTS_PER_BLOCK * sizeof *e, sizeof *e);
+	}
+}
+
+/* Returns the disk sector that contains byte offset POS within
+ * INODE.
+ * Returns -1 if INODE does not contain data for a byte at offset
+ * POS. */
+static disk_sector_t
+byte_to_sector (struct inode *inode, off_t pos) {
+	const struct inode_disk *data;
+	struct extent block[EXTENTS_PER_BLOCK];
+	size_t idx, i, j;
+
+	ASSERT (inode != NULL);
+	if (pos >= inode->data.length)
+		return -1;
+
+	/* Walk the extents, inline ones first, subtracting each
+	 * one's length until IDX falls inside one. */
+	data = &inode->data;
+	idx = pos / DISK_SECTOR_SIZE;
+	for (i = 0; i < data->extent_cnt && i < INLINE_EXTENTS; i++) {
+		if (idx < data->extents[i].length)
+			return data->extents[i].start + idx;
+		idx -= data->extents[i].length;
+	}
+	for (i = 0; i * EXTENTS_PER_BLOCK + INLINE_EXTENTS < data->extent_cnt;
+			i++) {
+		size_t cnt = data->extent_cnt - INLINE_EXTENTS - i * EXTENTS_PER_BLOCK;
+
+		if (cnt > EXTENTS_PER_BLOCK)
+			cnt = EXTENTS_PER_BLOCK;
+		buffer_cache_read (data->indirect[i], block, 0, cnt * sizeof *block);
+		for (j = 0; j < cnt; j++) {
+			if (idx < block[j].length)
+				return block[j].start + idx;
+			idx -= block[j].length;
+		}
+	}
+	NOT_REACHED ();
+}
+
+/* Appends the CNT sectors starting at START to the file
+ * described by DATA, merging them into its last extent if they
+ * follow it on disk.
+ * Returns false if DATA has no room for another extent. */
+static bool
+append_extent (struct inode_disk *data, disk_sector_t start, size_t cnt) {
+	struct extent e;
+	size_t idx = data->extent_cnt;
+
+	if (idx > 0) {
+		get_extent (data, idx - 1, &e);
+		if (e.start + e.length == start) {
+			e.length += cnt;
+			set_extent (data, idx - 1, &e);
+			return true;
+		}
+	}
+
+	if (idx >= MAX_EXTENTS)
+		return false;
+	if (idx >= INLINE_EXTENTS
+			&& (idx - INLINE_EXTENTS) % EXTENTS_PER_BLOCK == 0
+			&& !free_map_allocate (1, &data->indirect[(idx - INLINE_EXTENTS)
+					/ EXTENTS_PER_BLOCK]))
+		return false;
+
+	data->extent_cnt++;
+	e.start = start;
+	e.length = cnt;
+	set_extent (data, idx, &e);
+	return true;
+}
+
+/* Returns the number of bytes the file described by DATA can
+ * hold without allocating more sectors. */
+static off_t
+capacity (const struct inode_disk *data) {
+	return (off_t) data->sector_cnt * DISK_SECTOR_SIZE;
+}
+
+/* Adds zeroed data sectors to the end of the file described by
+ * DATA until it can hold LENGTH bytes.  Prefers to grow the last
+ * extent in place, and otherwise takes the longest free run that
+ * halving the request finds, so that large files stay mostly
+ * contiguous.  INODE is DATA's in-memory inode, or a null pointer
+ * if it has none yet; extents do not need it.
+ * Returns false if the disk or DATA fills up first, leaving the
+ * sectors added so far in place. */
+static bool
+extend (struct inode_disk *data, struct inode *inode UNUSED, off_t length) {
+	static char zeros[DISK_SECTOR_SIZE];
+	size_t want = bytes_to_sectors (length);
+	size_t cnt = want > data->sector_cnt ? want - data->sector_cnt : 0;
+
+	while (cnt > 0) {
+		disk_sector_t start = 0;
+		size_t got = 0;
+		size_t old_extent_cnt = data->extent_cnt;
+		size_t i;
+
+		if (data->extent_cnt > 0) {
+			struct extent last;
+
+			get_extent (data, data->extent_cnt - 1, &last);
+			start = last.start + last.length;
+			got = free_map_extend (start, cnt);
+		}
+		if (got == 0)
+			for (got = cnt; got > 0; got /= 2)
+				if (free_map_allocate (got, &start))
+					break;
+		if (got == 0)
+			return false;
+		if (!append_extent (data, start, got)) {
+			free_map_release (start, got);
+			return false;
+		}
+		count_alloc (got, data->extent_cnt != old_extent_cnt);
+
+		for (i = 0; i < got; i++)
+			buffer_cache_write (start + i, zeros, 0, DISK_SECTOR_SIZE);
+		data->sector_cnt += got;
+		cnt -= got;
+	}
+	return true;
 }
 
-/* List of open inodes, so that opening a single inode twice
- * returns the same `struct inode'. */
-static struct list open_inodes;
+/* Frees all of the data sectors and indirect blocks of the file
+ * described by DATA. */
+static void
+release_sectors (struct inode_disk *data) {
+	struct extent e;
+	size_t i;
+
+	for (i = 0; i < data->extent_cnt; i++) {
+		get_extent (data, i, &e);
+		free_map_release (e.start, e.length);
+	}
+	for (i = 0; i * EXTENTS_PER_BLOCK + INLINE_EXTENTS < data->extent_cnt;
+			i++)
+		free_map_release (data->indirect[i], 1);
+}
+#endif
+
+/* Open inodes, hashed by sector, so that opening a single inode
+ * twice returns the same `struct inode'. */
+static struct hash open_inodes;
+static struct lock open_inodes_lock;
+static struct inode inode_key;          /* For searching open_inodes. */
+
+/* Closed inodes kept for reuse, so that opening and closing a
+ * file does not go through malloc() and free().  At most
+ * INODE_SLAB_MAX are kept.  Guarded by open_inodes_lock. */
+#define INODE_SLAB_MAX 64
+static struct list inode_slab;
+static size_t inode_slab_cnt;
+
+static uint64_t
+inode_hash (const struct hash_elem *e, void *aux UNUSED) {
+	return hash_int (hash_entry (e, struct inode, elem)->sector);
+}
+
+static bool
+inode_less (const struct hash_elem *a, const struct hash_elem *b,
+		void *aux UNUSED) {
+	return (hash_entry (a, struct inode, elem)->sector
+			< hash_entry (b, struct inode, elem)->sector);
+}
 
 /* Initializes the inode module. */
 void
 inode_init (void) {
-	list_init (&open_inodes);
+	if (!hash_init (&open_inodes, inode_hash, inode_less, NULL))
+		PANIC ("open inode table creation failed");
+	lock_init (&open_inodes_lock);
+	list_init (&inode_slab);
+	lock_init (&stats_lock);
 }
 
 /* Initializes an inode with LENGTH bytes of data and
@@ -77,20 +510,13 @@ inode_create (disk_sector_t sector, off_t length) {
 
 	disk_inode = calloc (1, sizeof *disk_inode);
 	if (disk_inode != NULL) {
-		size_t sectors = bytes_to_sectors (length);
 		disk_inode->length = length;
 		disk_inode->magic = INODE_MAGIC;
-		if (free_map_allocate (sectors, &disk_inode->start)) {
-			disk_write (filesys_disk, sector, disk_inode);
-			if (sectors > 0) {
-				static char zeros[DISK_SECTOR_SIZE];
-				size_t i;
-
-				for (i = 0; i < sectors; i++) 
-					disk_write (filesys_disk, disk_inode->start + i, zeros); 
-			}
+		if (extend (disk_inode, NULL, length)) {
+			buffer_cache_write (sector, disk_inode, 0, DISK_SECTOR_SIZE);
 			success = true; 
-		} 
+		} else
+			release_sectors (disk_inode);
 		free (disk_inode);
 	}
 	return success;
@@ -101,39 +527,63 @@ inode_create (disk_sector_t sector, off_t length) {
  * Returns a null pointer if memory allocation fails. */
 struct inode *
 inode_open (disk_sector_t sector) {
-	struct list_elem *e;
+	struct hash_elem *e;
 	struct inode *inode;
 
 	/* Check whether this inode is already open. */
-	for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
-			e = list_next (e)) {
-		inode = list_entry (e, struct inode, elem);
-		if (inode->sector == sector) {
-			inode_reopen (inode);
-			return inode; 
-		}
+	lock_acquire (&open_inodes_lock);
+	inode_key.sector = sector;
+	e = hash_find (&open_inodes, &inode_key.elem);
+	if (e != NULL) {
+		inode = hash_entry (e, struct inode, elem);
+		inode->open_cnt++;
+		lock_release (&open_inodes_lock);
+		return inode; 
 	}
 
-	/* Allocate memory. */
-	inode = malloc (sizeof *inode);
-	if (inode == NULL)
-		return NULL;
+	/* Allocate memory, preferring a recycled inode. */
+	if (!list_empty (&inode_slab)) {
+		inode = list_entry (list_pop_front (&inode_slab), struct inode,
+				free_elem);
+		inode_slab_cnt--;
+	} else {
+		inode = malloc (sizeof *inode);
+		if (inode == NULL) {
+			lock_release (&open_inodes_lock);
+			return NULL;
+		}
+	}
 
-	/* Initialize. */
-	list_push_front (&open_inodes, &inode->elem);
+	/* Initialize.  Other openers may find the inode as soon as it
+	 * is in the table, so hold its lock until DATA is read in. */
 	inode->sector = sector;
 	inode->open_cnt = 1;
 	inode->deny_write_cnt = 0;
 	inode->removed = false;
-	disk_read (filesys_disk, inode->sector, &inode->data);
+	rwlock_init (&inode->lock);
+	rwlock_init (&inode->dir_lock);
+#ifdef EFILESYS
+	lock_init (&inode->map_lock);
+	inode->runs = NULL;
+	inode->run_cnt = inode->run_cap = 0;
+#endif
+	rwlock_acquire_write (&inode->lock);
+	hash_insert (&open_inodes, &inode->elem);
+	lock_release (&open_inodes_lock);
+
+	buffer_cache_read (inode->sector, &inode->data, 0, DISK_SECTOR_SIZE);
+	rwlock_release_write (&inode->lock);
 	return inode;
 }
 
 /* Reopens and returns INODE. */
 struct inode *
 inode_reopen (struct inode *inode) {
-	if (inode != NULL)
+	if (inode != NULL) {
+		lock_acquire (&open_inodes_lock);
 		inode->open_cnt++;
+		lock_release (&open_inodes_lock);
+	}
 	return inode;
 }
 
@@ -153,19 +603,38 @@ inode_close (struct inode *inode) {
 		return;
 
 	/* Release resources if this was the last opener. */
+	lock_acquire (&open_inodes_lock);
 	if (--inode->open_cnt == 0) {
-		/* Remove from inode list and release lock. */
-		list_remove (&inode->elem);
+		/* Remove from inode table and release lock. */
+		hash_delete (&open_inodes, &inode->elem);
+		lock_release (&open_inodes_lock);
 
 		/* Deallocate blocks if removed. */
 		if (inode->removed) {
-			free_map_release (inode->sector, 1);
-			free_map_release (inode->data.start,
-					bytes_to_sectors (inode->data.length)); 
+			if (inode->data.dir_index != 0) {
+				struct inode *index = inode_open (inode->data.dir_index);
+				if (index != NULL) {
+					inode_remove (index);
+					inode_close (index);
+				}
+			}
+			filesys_free_sector (inode->sector);
+			release_sectors (&inode->data);
 		}
 
+#ifdef EFILESYS
+		free (inode->runs);
+#endif
+		lock_acquire (&open_inodes_lock);
+		if (inode_slab_cnt < INODE_SLAB_MAX) {
+			list_push_front (&inode_slab, &inode->free_elem);
+			inode_slab_cnt++;
+			inode = NULL;
+		}
+		lock_release (&open_inodes_lock);
 		free (inode); 
-	}
+	} else
+		lock_release (&open_inodes_lock);
 }
 
 /* Marks INODE to be deleted when it is closed by the last caller who
@@ -173,7 +642,40 @@ inode_close (struct inode *inode) {
 void
 inode_remove (struct inode *inode) {
 	ASSERT (inode != NULL);
+	lock_acquire (&open_inodes_lock);
 	inode->removed = true;
+	lock_release (&open_inodes_lock);
+}
+
+/* Returns the sector of the inode that holds directory INODE's
+ * index, or 0 if it has none. */
+disk_sector_t
+inode_get_dir_index (struct inode *inode) {
+	disk_sector_t index;
+
+	rwlock_acquire_read (&inode->lock);
+	index = inode->data.dir_index;
+	rwlock_release_read (&inode->lock);
+	return index;
+}
+
+/* Records SECTOR as the inode that holds directory INODE's index.
+ * The index is removed along with INODE. */
+void
+inode_set_dir_index (struct inode *inode, disk_sector_t sector) {
+	rwlock_acquire_write (&inode->lock);
+	inode->data.dir_index = sector;
+	buffer_cache_write (inode->sector, &inode->data, 0, DISK_SECTOR_SIZE);
+	rwlock_release_write (&inode->lock);
+}
+
+/* Returns the lock that serializes changes to the entries of
+ * directory INODE against lookups.  It is separate from the lock
+ * on INODE's contents because a directory operation spans several
+ * reads and writes of them. */
+struct rwlock *
+inode_dir_lock (struct inode *inode) {
+	return &inode->dir_lock;
 }
 
 /* Reads SIZE bytes from INODE into BUFFER, starting at position OFFSET.
@@ -183,15 +685,15 @@ off_t
 inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
 	uint8_t *buffer = buffer_;
 	off_t bytes_read = 0;
-	uint8_t *bounce = NULL;
 
+	rwlock_acquire_read (&inode->lock);
 	while (size > 0) {
 		/* Disk sector to read, starting byte offset within sector. */
 		disk_sector_t sector_idx = byte_to_sector (inode, offset);
 		int sector_ofs = offset % DISK_SECTOR_SIZE;
 
 		/* Bytes left in inode, bytes left in sector, lesser of the two. */
-		off_t inode_left = inode_length (inode) - offset;
+		off_t inode_left = inode->data.length - offset;
 		int sector_left = DISK_SECTOR_SIZE - sector_ofs;
 		int min_left = inode_left < sector_left ? inode_left : sector_left;
 
@@ -200,45 +702,70 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
 		if (chunk_size <= 0)
 			break;
 
-		if (sector_ofs == 0 && chunk_size == DISK_SECTOR_SIZE) {
-			/* Read full sector directly into caller's buffer. */
-			disk_read (filesys_disk, sector_idx, buffer + bytes_read); 
-		} else {
-			/* Read sector into bounce buffer, then partially copy
-			 * into caller's buffer. */
-			if (bounce == NULL) {
-				bounce = malloc (DISK_SECTOR_SIZE);
-				if (bounce == NULL)
-					break;
-			}
-			disk_read (filesys_disk, sector_idx, bounce);
-			memcpy (buffer + bytes_read, bounce + sector_ofs, chunk_size);
-		}
+		buffer_cache_read (sector_idx, buffer + bytes_read, sector_ofs,
+				chunk_size);
 
 		/* Advance. */
 		size -= chunk_size;
 		offset += chunk_size;
 		bytes_read += chunk_size;
 	}
-	free (bounce);
+	rwlock_release_read (&inode->lock);
 
 	return bytes_read;
 }
 
+/* Starts reading the sectors that hold SIZE bytes of INODE at
+ * OFFSET into the buffer cache, without waiting for them.  Bytes
+ * past end of file are ignored. */
+void
+inode_readahead (struct inode *inode, off_t size, off_t offset) {
+	off_t end;
+
+	rwlock_acquire_read (&inode->lock);
+	end = offset + size;
+	if (end > inode->data.length)
+		end = inode->data.length;
+	for (offset = ROUND_DOWN (offset, DISK_SECTOR_SIZE); offset < end;
+			offset += DISK_SECTOR_SIZE)
+		buffer_cache_readahead (byte_to_sector (inode, offset));
+	rwlock_release_read (&inode->lock);
+}
+
+/* Extends INODE so that it is at least LENGTH bytes long, or as
+ * close to that as free space allows.  The new bytes read as
+ * zeros.  INODE's lock must be held for writing. */
+static void
+grow (struct inode *inode, off_t length) {
+	off_t limit;
+
+	extend (&inode->data, inode, length);
+	limit = capacity (&inode->data);
+	if (length > limit)
+		length = limit;
+	if (length > inode->data.length) {
+		inode->data.length = length;
+		buffer_cache_write (inode->sector, &inode->data, 0, DISK_SECTOR_SIZE);
+	}
+}
+
 /* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET.
  * Returns the number of bytes actually written, which may be
- * less than SIZE if end of file is reached or an error occurs.
- * (Normally a write at end of file would extend the inode, but
- * growth is not yet implemented.) */
+ * less than SIZE if the disk fills up.  A write past end of file
+ * extends the inode first. */
 off_t
 inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 		off_t offset) {
 	const uint8_t *buffer = buffer_;
 	off_t bytes_written = 0;
-	uint8_t *bounce = NULL;
 
-	if (inode->deny_write_cnt)
+	rwlock_acquire_write (&inode->lock);
+	if (inode->deny_write_cnt) {
+		rwlock_release_write (&inode->lock);
 		return 0;
+	}
+	if (size > 0 && offset + size > inode->data.length)
+		grow (inode, offset + size);
 
 	while (size > 0) {
 		/* Sector to write, starting byte offset within sector. */
@@ -246,7 +773,7 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 		int sector_ofs = offset % DISK_SECTOR_SIZE;
 
 		/* Bytes left in inode, bytes left in sector, lesser of the two. */
-		off_t inode_left = inode_length (inode) - offset;
+		off_t inode_left = inode->data.length - offset;
 		int sector_left = DISK_SECTOR_SIZE - sector_ofs;
 		int min_left = inode_left < sector_left ? inode_left : sector_left;
 
@@ -255,34 +782,17 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 		if (chunk_size <= 0)
 			break;
 
-		if (sector_ofs == 0 && chunk_size == DISK_SECTOR_SIZE) {
-			/* Write full sector directly to disk. */
-			disk_write (filesys_disk, sector_idx, buffer + bytes_written); 
-		} else {
-			/* We need a bounce buffer. */
-			if (bounce == NULL) {
-				bounce = malloc (DISK_SECTOR_SIZE);
-				if (bounce == NULL)
-					break;
-			}
-
-			/* If the sector contains data before or after the chunk
-			   we're writing, then we need to read in the sector
-			   first.  Otherwise we start with a sector of all zeros. */
-			if (sector_ofs > 0 || chunk_size < sector_left) 
-				disk_read (filesys_disk, sector_idx, bounce);
-			else
-				memset (bounce, 0, DISK_SECTOR_SIZE);
-			memcpy (bounce + sector_ofs, buffer + bytes_written, chunk_size);
-			disk_write (filesys_disk, sector_idx, bounce); 
-		}
+		/* The cache reads the rest of the sector in first unless
+		 * the chunk covers all of it. */
+		buffer_cache_write (sector_idx, buffer + bytes_written, sector_ofs,
+				chunk_size);
 
 		/* Advance. */
 		size -= chunk_size;
 		offset += chunk_size;
 		bytes_written += chunk_size;
 	}
-	free (bounce);
+	rwlock_release_write (&inode->lock);
 
 	return bytes_written;
 }
@@ -292,8 +802,10 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 	void
 inode_deny_write (struct inode *inode) 
 {
+	rwlock_acquire_write (&inode->lock);
 	inode->deny_write_cnt++;
 	ASSERT (inode->deny_write_cnt <= inode->open_cnt);
+	rwlock_release_write (&inode->lock);
 }
 
 /* Re-enables writes to INODE.
@@ -301,13 +813,29 @@ inode_deny_write (struct inode *inode)
  * inode_deny_write() on the inode, before closing the inode. */
 void
 inode_allow_write (struct inode *inode) {
+	rwlock_acquire_write (&inode->lock);
 	ASSERT (inode->deny_write_cnt > 0);
 	ASSERT (inode->deny_write_cnt <= inode->open_cnt);
 	inode->deny_write_cnt--;
+	rwlock_release_write (&inode->lock);
 }
 
 /* Returns the length, in bytes, of INODE's data. */
 off_t
-inode_length (const struct inode *inode) {
-	return inode->data.length;
+inode_length (struct inode *inode) {
+	off_t length;
+
+	rwlock_acquire_read (&inode->lock);
+	length = inode->data.length;
+	rwlock_release_read (&inode->lock);
+	return length;
+}
+
+/* Prints file data allocation statistics.  Fewer extents for the
+ * same number of sectors means files were laid out more
+ * contiguously. */
+void
+inode_print_stats (void) {
+	printf ("Inodes: %lld data sectors allocated in %lld extents\n",
+			alloc_sector_cnt, alloc_extent_cnt);
 }
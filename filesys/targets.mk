@@ -4,5 +4,7 @@ filesys_SRC += filesys/free-map.c	# Free sector bitmap.
 filesys_SRC += filesys/file.c		# Files.
 filesys_SRC += filesys/directory.c	# Directories.
 filesys_SRC += filesys/inode.c		# File headers.
+filesys_SRC += filesys/buffer_cache.c	# Sector cache.
+filesys_SRC += filesys/dcache.c		# Name cache.
 filesys_SRC += filesys/fsutil.c		# Utilities.
 filesys_SRC += filesys/page_cache.c		# Page cache.
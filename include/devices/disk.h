@@ -2,7 +2,11 @@
 #define DEVICES_DISK_H
 
 #include <inttypes.h>
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
+#include "threads/synch.h"
 
 /* Size of a disk sector in bytes. */
 #define DISK_SECTOR_SIZE 512
@@ -15,13 +19,50 @@ typedef uint32_t disk_sector_t;
  * printf ("sector=%"PRDSNu"\n", sector); */
 #define PRDSNu PRIu32
 
+/* Most sectors that one disk_read_multiple() or
+ * disk_write_multiple() call may transfer. */
+#define DISK_MULTIPLE_MAX 256
+
+/* An asynchronous request to transfer CNT sectors, starting at
+ * SECTOR, between DISK and BUFFER.  The caller fills in the
+ * members up to COMPLETE and passes it to disk_submit(), then
+ * either waits for it with disk_wait() or, if COMPLETE is
+ * nonnull, is told of completion by a call to COMPLETE.  The
+ * request must stay allocated until then. */
+struct disk_req {
+	struct disk *disk;          /* Disk to access. */
+	disk_sector_t sector;       /* First sector. */
+	size_t cnt;                 /* Number of sectors, 1 to
+	                               DISK_MULTIPLE_MAX. */
+	void *buffer;               /* CNT * DISK_SECTOR_SIZE bytes. */
+	bool write;                 /* Write to disk, or read from it? */
+
+	/* If nonnull, called from the disk interrupt handler when
+	 * the transfer completes, in place of waking disk_wait().
+	 * It must not sleep or submit further requests.  The driver
+	 * does not touch the request afterward. */
+	void (*complete) (struct disk_req *);
+	void *aux;                  /* For COMPLETE's use. */
+
+	/* Owned by the driver. */
+	int64_t deadline;           /* Tick by which it should be started. */
+	struct list_elem elem;      /* In a channel's queue or batch. */
+	struct semaphore done;      /* Up'd on completion. */
+};
+
 void disk_init (void);
 void disk_print_stats (void);
+bool disk_set_scheduler (const char *name);
 
 struct disk *disk_get (int chan_no, int dev_no);
 disk_sector_t disk_size (struct disk *);
 void disk_read (struct disk *, disk_sector_t, void *);
 void disk_write (struct disk *, disk_sector_t, const void *);
+void disk_read_multiple (struct disk *, disk_sector_t, void *, size_t cnt);
+void disk_write_multiple (struct disk *, disk_sector_t, const void *,
+		size_t cnt);
+void disk_submit (struct disk_req *);
+void disk_wait (struct disk_req *);
 
 void 	register_disk_inspect_intr ();
 #endif /* devices/disk.h */
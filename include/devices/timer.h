@@ -2,6 +2,7 @@
 #define DEVICES_TIMER_H
 
 #include <round.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 /* Number of timer interrupts per second. */
@@ -18,6 +19,27 @@ void timer_msleep (int64_t milliseconds);
 void timer_usleep (int64_t microseconds);
 void timer_nsleep (int64_t nanoseconds);
 
+/* Busy waits. */
+void timer_udelay (int64_t microseconds);
+void timer_ndelay (int64_t nanoseconds);
+
+/* Stop the periodic tick while idle? */
+extern bool timer_tickless;
+
+void timer_idle_enter (void);
+int64_t timer_idle_exit (void);
+
 void timer_print_stats (void);
 
+/* Timer interrupt handler cost, measured with the time-stamp
+   counter. */
+struct timer_intr_stats {
+	int64_t count;              /* Number of interrupts handled. */
+	uint64_t cycles;            /* Total cycles spent in the handler. */
+	uint64_t max_cycles;        /* Most expensive single interrupt. */
+};
+
+void timer_get_intr_stats (struct timer_intr_stats *);
+void timer_reset_intr_stats (void);
+
 #endif /* devices/timer.h */
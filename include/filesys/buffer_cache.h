@@ -0,0 +1,27 @@
+#ifndef FILESYS_BUFFER_CACHE_H
+#define FILESYS_BUFFER_CACHE_H
+
+#include <stddef.h>
+#include "devices/disk.h"
+
+/* Number of sectors held in the buffer cache. */
+#define BUFFER_CACHE_SIZE 64
+
+/* Write-behind tuning.  A dirty sector is written back once it
+ * has been dirty for BUFFER_CACHE_DIRTY_AGE timer ticks; the
+ * flusher checks every BUFFER_CACHE_FLUSH_INTERVAL ticks.  A
+ * writer that finds BUFFER_CACHE_DIRTY_MAX sectors dirty writes
+ * them back itself before adding another. */
+#define BUFFER_CACHE_DIRTY_AGE 100
+#define BUFFER_CACHE_FLUSH_INTERVAL 25
+#define BUFFER_CACHE_DIRTY_MAX (BUFFER_CACHE_SIZE / 2)
+
+void buffer_cache_init (void);
+void buffer_cache_read (disk_sector_t, void *, size_t ofs, size_t size);
+void buffer_cache_write (disk_sector_t, const void *, size_t ofs, size_t size);
+void buffer_cache_readahead (disk_sector_t);
+void buffer_cache_flush (void);
+void buffer_cache_done (void);
+void buffer_cache_print_stats (void);
+
+#endif /* filesys/buffer_cache.h */
@@ -0,0 +1,24 @@
+#ifndef FILESYS_DCACHE_H
+#define FILESYS_DCACHE_H
+
+#include <stdbool.h>
+#include "devices/disk.h"
+
+/* Number of names held in the name cache. */
+#define DCACHE_SIZE 256
+
+/* Result of a name cache lookup. */
+enum dcache_result {
+	DCACHE_MISS,                /* Not cached; search the directory. */
+	DCACHE_PRESENT,             /* The name exists. */
+	DCACHE_ABSENT               /* The name does not exist. */
+};
+
+void dcache_init (void);
+enum dcache_result dcache_lookup (disk_sector_t dir, const char *name,
+		disk_sector_t *sectorp);
+void dcache_insert (disk_sector_t dir, const char *name, bool present,
+		disk_sector_t sector);
+void dcache_print_stats (void);
+
+#endif /* filesys/dcache.h */
@@ -17,10 +17,15 @@ typedef uint32_t cluster_t;  /* Index of a cluster within FAT. */
 #define SECTORS_PER_CLUSTER 1 /* Number of sectors per cluster */
 #define FAT_BOOT_SECTOR 0     /* FAT boot sector. */
 #define ROOT_DIR_CLUSTER 1    /* Cluster for the root directory */
+#define FAT_ENTRIES_PER_SECTOR (DISK_SECTOR_SIZE / sizeof (cluster_t))
+
+/* Timer ticks between writebacks of dirty FAT sectors. */
+#define FAT_FLUSH_INTERVAL 100
 
 void fat_init (void);
 void fat_open (void);
 void fat_close (void);
+void fat_flush (void);
 void fat_create (void);
 void fat_close (void);
 
@@ -34,5 +39,6 @@ void fat_remove_chain (
 cluster_t fat_get (cluster_t clst);
 void fat_put (cluster_t clst, cluster_t val);
 disk_sector_t cluster_to_sector (cluster_t clst);
+cluster_t sector_to_cluster (disk_sector_t sector);
 
 #endif /* filesys/fat.h */
@@ -3,10 +3,18 @@
 
 #include <stdbool.h>
 #include "filesys/off_t.h"
+#include "devices/disk.h"
+#ifdef EFILESYS
+#include "filesys/fat.h"
+#endif
 
 /* Sectors of system file inodes. */
 #define FREE_MAP_SECTOR 0       /* Free map file inode sector. */
+#ifdef EFILESYS
+#define ROOT_DIR_SECTOR cluster_to_sector (ROOT_DIR_CLUSTER)
+#else
 #define ROOT_DIR_SECTOR 1       /* Root directory file inode sector. */
+#endif
 
 /* Disk used for file system. */
 extern struct disk *filesys_disk;
@@ -16,5 +24,7 @@ void filesys_done (void);
 bool filesys_create (const char *name, off_t initial_size);
 struct file *filesys_open (const char *name);
 bool filesys_remove (const char *name);
+bool filesys_alloc_sector (disk_sector_t *);
+void filesys_free_sector (disk_sector_t);
 
 #endif /* filesys/filesys.h */
@@ -6,6 +6,7 @@
 #include "devices/disk.h"
 
 struct bitmap;
+struct rwlock;
 
 void inode_init (void);
 bool inode_create (disk_sector_t, off_t);
@@ -16,8 +17,13 @@ void inode_close (struct inode *);
 void inode_remove (struct inode *);
 off_t inode_read_at (struct inode *, void *, off_t size, off_t offset);
 off_t inode_write_at (struct inode *, const void *, off_t size, off_t offset);
+void inode_readahead (struct inode *, off_t size, off_t offset);
 void inode_deny_write (struct inode *);
 void inode_allow_write (struct inode *);
-off_t inode_length (const struct inode *);
+off_t inode_length (struct inode *);
+void inode_print_stats (void);
+struct rwlock *inode_dir_lock (struct inode *);
+disk_sector_t inode_get_dir_index (struct inode *);
+void inode_set_dir_index (struct inode *, disk_sector_t);
 
 #endif /* filesys/inode.h */
@@ -0,0 +1,63 @@
+#ifndef THREADS_FIXED_POINT_H
+#define THREADS_FIXED_POINT_H
+
+#include <stdint.h>
+
+/* Signed 17.14 fixed-point real numbers, as used by the 4.4BSD
+   scheduler for recent_cpu and load_avg.  The top 17 bits hold
+   the integer part and the low 14 bits the fraction, so values
+   up to about +/-131,071 can be represented. */
+typedef int fixed_t;
+
+#define FP_SHIFT 14
+#define FP_ONE (1 << FP_SHIFT)
+
+/* Converts integer N to fixed point. */
+static inline fixed_t
+fp_int (int n) {
+	return n * FP_ONE;
+}
+
+/* Converts X to an integer, rounding toward zero. */
+static inline int
+fp_trunc (fixed_t x) {
+	return x / FP_ONE;
+}
+
+/* Converts X to an integer, rounding to nearest. */
+static inline int
+fp_round (fixed_t x) {
+	return x >= 0 ? (x + FP_ONE / 2) / FP_ONE : (x - FP_ONE / 2) / FP_ONE;
+}
+
+/* Returns X + N, for integer N. */
+static inline fixed_t
+fp_add_int (fixed_t x, int n) {
+	return x + n * FP_ONE;
+}
+
+/* Returns X * Y. */
+static inline fixed_t
+fp_mul (fixed_t x, fixed_t y) {
+	return ((int64_t) x) * y / FP_ONE;
+}
+
+/* Returns X * N, for integer N. */
+static inline fixed_t
+fp_mul_int (fixed_t x, int n) {
+	return x * n;
+}
+
+/* Returns X / Y. */
+static inline fixed_t
+fp_div (fixed_t x, fixed_t y) {
+	return ((int64_t) x) * FP_ONE / y;
+}
+
+/* Returns X / N, for integer N. */
+static inline fixed_t
+fp_div_int (fixed_t x, int n) {
+	return x / n;
+}
+
+#endif /* threads/fixed_point.h */
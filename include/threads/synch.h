@@ -44,6 +44,36 @@ void cond_wait (struct condition *, struct lock *);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
 
+/* Reader-writer lock.  Any number of threads may hold it shared,
+   or one thread exclusive.  Once a writer is waiting, new readers
+   wait behind it, so that writers are not starved.  Holders of
+   either kind receive the priority of the threads waiting for
+   them. */
+struct rwlock {
+	struct thread *writer;      /* Exclusive holder, if any. */
+	int reader_cnt;             /* Number of shared holders. */
+	struct list readers;        /* Shared holders' rwlock_holds. */
+	struct list read_waiters;   /* Threads waiting to read. */
+	struct list write_waiters;  /* Threads waiting to write. */
+};
+
+/* One thread's hold on an rwlock, shared or exclusive. */
+struct rwlock_hold {
+	struct rwlock *rwlock;      /* Held rwlock, or null if unused. */
+	struct thread *thread;      /* The holding thread. */
+	struct list_elem elem;      /* Element in rwlock's readers. */
+};
+
+/* Maximum number of rwlocks one thread may hold at a time. */
+#define RWLOCK_HOLD_MAX 4
+
+void rwlock_init (struct rwlock *);
+void rwlock_acquire_read (struct rwlock *);
+void rwlock_release_read (struct rwlock *);
+void rwlock_acquire_write (struct rwlock *);
+void rwlock_release_write (struct rwlock *);
+bool rwlock_write_held_by_current_thread (const struct rwlock *);
+
 bool cmp_sema_priority (const struct list_elem *a, const struct list_elem *b, void *aux);
 bool cmp_donor_priority (const struct list_elem *new, const struct list_elem *existing, void *aux);
 
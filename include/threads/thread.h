@@ -4,6 +4,7 @@
 #include <debug.h>
 #include <list.h>
 #include <stdint.h>
+#include "threads/fixed_point.h"
 #include "threads/interrupt.h"
 #include "threads/synch.h"
 #ifdef VM
@@ -29,6 +30,11 @@ typedef int tid_t;
 #define PRI_DEFAULT 31 /* Default priority. */
 #define PRI_MAX 63	   /* Highest priority. */
 
+/* Thread niceness, for the MLFQS. */
+#define NICE_MIN -20	 /* Nicest to other threads. */
+#define NICE_DEFAULT 0 /* Default niceness. */
+#define NICE_MAX 20	 /* Least nice. */
+
 #define FDCOUNT_LIMIT FDT_PAGES * (1 << 9)
 #define FDT_PAGES 3
 /* A kernel thread or user process.
@@ -106,6 +112,13 @@ struct thread
 	struct lock *waiting_for_this_lock;
 	struct list donors_list;
 	struct list_elem d_elem;
+	struct rwlock_hold rw_holds[RWLOCK_HOLD_MAX]; /* rwlocks held. */
+
+	/* Owned by thread.c, used only by the MLFQS. */
+	int nice;				   /* Niceness. */
+	fixed_t recent_cpu;		   /* Decayed CPU usage. */
+	int64_t mlfqs_epoch;	   /* Seconds of decay applied to recent_cpu. */
+	struct list_elem all_elem; /* Element in the list of all threads. */
 
 	int exit_status;
 	struct file **fd_table;
@@ -120,9 +133,6 @@ struct thread
 	struct semaphore fork_sema;
 	struct semaphore free_sema;
 
-	/* -- Project 3 --*/
-	struct supplemental_page_table spt;
-
 	int stdin_count;
 	int stdout_count;
 
@@ -174,15 +184,15 @@ int thread_get_load_avg(void);
 
 void do_iret(struct intr_frame *tf);
 
-void thread_sleep(int64_t ticks);			   /* 실행 중인 thread를 슬립으로 만듦 */
-void thread_awake(int64_t ticks);			   /* sleep_list에서 꺠워야 할 thread를 깨움 */
-void update_next_tick_to_awake(int64_t ticks); /* 최소 틱을 가진 thread 저장 */
-int64_t get_next_tick_to_awake(void);		   /* thread.c의 next_tick_to_awake 반환 */
+void thread_sleep(int64_t ticks);	   /* 실행 중인 thread를 슬립으로 만듦 */
+void thread_awake(int64_t ticks);	   /* sleep wheel에서 꺠워야 할 thread를 깨움 */
+int64_t get_next_tick_to_awake(void); /* 가장 먼저 깨어날 틱의 하한 반환 */
 
 /* If the newly created thread has a higher priority than the running thread,
    then the current running thread yields.
  */
 void test_max_priority(void);
+void thread_change_priority(struct thread *t, int priority);
 bool cmp_priority(const struct list_elem *a, const struct list_elem *b, void *aux UNUSED);
 
 void donate_priority(void);
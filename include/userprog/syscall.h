@@ -4,6 +4,4 @@
 void syscall_init (void);
 void check_address (void *addr);
 
-struct lock filesys_lock;
-
 #endif /* userprog/syscall.h */
\ No newline at end of file
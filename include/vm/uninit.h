@@ -14,6 +14,7 @@ struct uninit_page {
 	vm_initializer *init;
 	enum vm_type type;
 	void *aux;
+	size_t aux_size;   /* Bytes at AUX, or 0 if unknown. */
 	/* Initiate the struct page and maps the pa to the va */
 	bool (*page_initializer) (struct page *, enum vm_type, void *kva);
 };
@@ -21,4 +22,5 @@ struct uninit_page {
 void uninit_new (struct page *page, void *va, vm_initializer *init,
 		enum vm_type type, void *aux,
 		bool (*initializer)(struct page *, enum vm_type, void *kva));
+bool uninit_adopt (struct page *page, void *kva);
 #endif
@@ -1,6 +1,7 @@
 #ifndef VM_VM_H
 #define VM_VM_H
 #include <stdbool.h>
+#include <hash.h>
 #include "threads/palloc.h"
 
 enum vm_type {
@@ -36,6 +37,15 @@ struct thread;
 
 #define VM_TYPE(type) ((type) & 7)
 
+/* Where a shareable page's contents come from: READ_BYTES bytes at
+ * OFS in INODE, followed by zeros.  Read-only pages with equal keys
+ * hold equal contents, so a single frame can back all of them. */
+struct share_key {
+	struct inode *inode;         /* Null if the page is private. */
+	off_t ofs;
+	size_t read_bytes;
+};
+
 /* The representation of "page".
  * This is kind of "parent class", which has four "child class"es, which are
  * uninit_page, file_page, anon_page, and page cache (project4).
@@ -46,7 +56,9 @@ struct page {
 	struct frame *frame;   /* Back reference for frame */
 
 	/* Your implementation */
-	struct hash_elem hash_elem;
+	struct hash_elem hash_elem;  /* Element in supplemental_page_table. */
+	bool writable;               /* May the user process write it? */
+	struct share_key share;      /* Origin, if the frame may be shared. */
 	/* Per-type data are binded into the union.
 	 * Each function automatically detects the current union */
 	union {
@@ -62,7 +74,11 @@ struct page {
 /* The representation of "frame" */
 struct frame {
 	void *kva;
-	struct page *page;
+	struct page *page;           /* Null once the frame was shared. */
+
+	int ref_cnt;                 /* Pages mapping this frame. */
+	struct share_key share;      /* Contents, if in the shared table. */
+	struct hash_elem share_elem; /* Element in the shared table. */
 };
 
 /* The function table for page operations.
@@ -106,7 +122,11 @@ bool vm_try_handle_fault (struct intr_frame *f, void *addr, bool user,
 	vm_alloc_page_with_initializer ((type), (upage), (writable), NULL, NULL)
 bool vm_alloc_page_with_initializer (enum vm_type type, void *upage,
 		bool writable, vm_initializer *init, void *aux);
+bool vm_alloc_page_with_aux (enum vm_type type, void *upage, bool writable,
+		vm_initializer *init, const void *aux, size_t aux_size);
 void vm_dealloc_page (struct page *page);
+void vm_share_page (void *upage, struct inode *inode, off_t ofs,
+		size_t read_bytes);
 bool vm_claim_page (void *va);
 enum vm_type page_get_type (struct page *page);
 
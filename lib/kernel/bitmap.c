@@ -266,7 +266,9 @@ bitmap_all (const struct bitmap *b, size_t start, size_t cnt) {
 /* Finds and returns the starting index of the first group of CNT
    consecutive bits in B at or after START that are all set to
    VALUE.
-   If there is no such group, returns BITMAP_ERROR. */
+   If there is no such group, returns BITMAP_ERROR.
+   Makes a single pass, stepping over whole elements at a time
+   where they are all VALUE or all !VALUE. */
 size_t
 bitmap_scan (const struct bitmap *b, size_t start, size_t cnt, bool value) {
 	ASSERT (b != NULL);
@@ -274,10 +276,32 @@ bitmap_scan (const struct bitmap *b, size_t start, size_t cnt, bool value) {
 
 	if (cnt <= b->bit_cnt) {
 		size_t last = b->bit_cnt - cnt;
-		size_t i;
-		for (i = start; i <= last; i++)
-			if (!bitmap_contains (b, i, cnt, !value))
-				return i;
+		elem_type all = value ? (elem_type) -1 : 0;
+		size_t run = start;     /* Start of the current run of VALUE. */
+		size_t i = start;
+
+		if (cnt == 0)
+			return start <= last ? start : BITMAP_ERROR;
+		while (run <= last) {
+			if (i % ELEM_BITS == 0 && i + ELEM_BITS <= b->bit_cnt) {
+				elem_type e = b->bits[elem_idx (i)];
+				if (e == ~all) {
+					i += ELEM_BITS;
+					run = i;
+					continue;
+				} else if (e == all) {
+					i += ELEM_BITS;
+					if (i - run >= cnt)
+						return run;
+					continue;
+				}
+			}
+			if (bitmap_test (b, i) == value) {
+				if (++i - run == cnt)
+					return run;
+			} else
+				run = ++i;
+		}
 	}
 	return BITMAP_ERROR;
 }
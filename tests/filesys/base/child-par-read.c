@@ -0,0 +1,47 @@
+/* Child process for par-read test.
+   Reads the whole test file ROUND_CNT times, CHUNK_SIZE bytes at
+   a time, and verifies every chunk. */
+
+#include <random.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/filesys/base/par-read.h"
+
+const char *test_name = "child-par-read";
+
+static char buf[BUF_SIZE];
+static char chunk[CHUNK_SIZE];
+
+int
+main (int argc, const char *argv[]) 
+{
+  int child_idx;
+  int fd;
+  int round;
+  size_t ofs;
+
+  quiet = true;
+  
+  CHECK (argc == 2, "argc must be 2, actually %d", argc);
+  child_idx = atoi (argv[1]);
+
+  random_init (0);
+  random_bytes (buf, sizeof buf);
+
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  for (round = 0; round < ROUND_CNT; round++) 
+    {
+      seek (fd, 0);
+      for (ofs = 0; ofs < sizeof buf; ofs += CHUNK_SIZE) 
+        {
+          CHECK (read (fd, chunk, CHUNK_SIZE) == CHUNK_SIZE,
+                 "read \"%s\"", file_name);
+          compare_bytes (chunk, buf + ofs, CHUNK_SIZE, ofs, file_name);
+        }
+    }
+  close (fd);
+
+  return child_idx;
+}
@@ -0,0 +1,75 @@
+/* Child process for syn-mix test.
+   Even-numbered children create a private file and ROUND_CNT
+   times overwrite it CHUNK_SIZE bytes at a time, then read it
+   back and verify it.  Odd-numbered children read and verify the
+   shared file ROUND_CNT times. */
+
+#include <random.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/filesys/base/syn-mix.h"
+
+const char *test_name = "child-syn-mix";
+
+static char buf[BUF_SIZE];
+static char chunk[CHUNK_SIZE];
+
+/* Reads NAME from the start through FD and compares it against
+   buf. */
+static void
+verify (int fd, const char *name) 
+{
+  size_t ofs;
+
+  seek (fd, 0);
+  for (ofs = 0; ofs < sizeof buf; ofs += CHUNK_SIZE) 
+    {
+      CHECK (read (fd, chunk, CHUNK_SIZE) == CHUNK_SIZE, "read \"%s\"", name);
+      compare_bytes (chunk, buf + ofs, CHUNK_SIZE, ofs, name);
+    }
+}
+
+int
+main (int argc, const char *argv[]) 
+{
+  char name[16];
+  int child_idx;
+  int fd;
+  int round;
+  size_t ofs;
+
+  quiet = true;
+  
+  CHECK (argc == 2, "argc must be 2, actually %d", argc);
+  child_idx = atoi (argv[1]);
+
+  random_init (0);
+  random_bytes (buf, sizeof buf);
+
+  if (child_idx % 2 == 0) 
+    {
+      snprintf (name, sizeof name, "private%d", child_idx);
+      CHECK (create (name, 0), "create \"%s\"", name);
+      CHECK ((fd = open (name)) > 1, "open \"%s\"", name);
+      for (round = 0; round < ROUND_CNT; round++) 
+        {
+          seek (fd, 0);
+          for (ofs = 0; ofs < sizeof buf; ofs += CHUNK_SIZE)
+            CHECK (write (fd, buf + ofs, CHUNK_SIZE) == CHUNK_SIZE,
+                   "write \"%s\"", name);
+          verify (fd, name);
+        }
+    }
+  else 
+    {
+      snprintf (name, sizeof name, "%s", shared_name);
+      CHECK ((fd = open (name)) > 1, "open \"%s\"", name);
+      for (round = 0; round < ROUND_CNT; round++)
+        verify (fd, name);
+    }
+  close (fd);
+
+  return child_idx;
+}
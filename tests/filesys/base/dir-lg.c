@@ -0,0 +1,70 @@
+/* Creates 1,000 files in the root directory, opens them in
+   random order, removes every other one, and then checks that
+   exactly the rest can still be opened.  Every step is a name
+   lookup in a large directory, so the run time shows how lookup
+   cost grows with directory size.  Compare the shutdown "Timer: N
+   ticks" line against the previous kernel. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_CNT 1000
+
+static int order[FILE_CNT];
+
+/* Stores the name of file I into NAME. */
+static void
+file_name (char name[16], int i)
+{
+  snprintf (name, 16, "f%d", i);
+}
+
+void
+test_main (void)
+{
+  char name[16];
+  int fd;
+  int i;
+
+  msg ("create %d files", FILE_CNT);
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      file_name (name, i);
+      if (!create (name, 0))
+        fail ("create \"%s\" failed", name);
+      order[i] = i;
+    }
+
+  msg ("open %d files in random order", FILE_CNT);
+  shuffle (order, FILE_CNT, sizeof *order);
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      file_name (name, order[i]);
+      if ((fd = open (name)) < 2)
+        fail ("open \"%s\" failed", name);
+      close (fd);
+    }
+
+  msg ("remove %d files", FILE_CNT / 2);
+  for (i = 0; i < FILE_CNT; i += 2)
+    {
+      file_name (name, i);
+      if (!remove (name))
+        fail ("remove \"%s\" failed", name);
+    }
+
+  msg ("check remaining files");
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      file_name (name, i);
+      fd = open (name);
+      if (i % 2 == 0 && fd >= 0)
+        fail ("removed file \"%s\" still opens", name);
+      if (i % 2 == 1 && fd < 2)
+        fail ("open \"%s\" failed", name);
+      if (fd >= 2)
+        close (fd);
+    }
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(dir-lg) begin
+(dir-lg) create 1000 files
+(dir-lg) open 1000 files in random order
+(dir-lg) remove 500 files
+(dir-lg) check remaining files
+(dir-lg) end
+EOF
+pass;
@@ -0,0 +1,65 @@
+/* Grows a 4 MB file from empty, 1,234 bytes at a time, then
+   reads it back sequentially to verify its contents.  Nearly
+   every write extends the file, so the run time is dominated by
+   file growth, and the shutdown "Inodes:" line shows how many
+   extents the data ended up in.  Compare that line and the
+   "Timer: N ticks" line against the previous kernel. */
+
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define TEST_SIZE (4 * 1024 * 1024)
+#define BLOCK_SIZE 1234
+
+static char block[BLOCK_SIZE];
+static char expected[BLOCK_SIZE];
+
+/* Fills the first SIZE bytes of BUF with the bytes expected at
+   offset OFS. */
+static void
+fill (char *buf, size_t ofs, size_t size)
+{
+  size_t i;
+
+  for (i = 0; i < size; i++)
+    buf[i] = (uint32_t) ((ofs + i) * 2654435761u) >> 24;
+}
+
+void
+test_main (void)
+{
+  const char *file_name = "growme";
+  size_t ofs;
+  int fd;
+
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+
+  msg ("grow \"%s\" to %d bytes", file_name, TEST_SIZE);
+  for (ofs = 0; ofs < TEST_SIZE; ofs += BLOCK_SIZE)
+    {
+      size_t size = TEST_SIZE - ofs < BLOCK_SIZE ? TEST_SIZE - ofs : BLOCK_SIZE;
+
+      fill (block, ofs, size);
+      if (write (fd, block, size) != (int) size)
+        fail ("write %zu bytes at offset %zu failed", size, ofs);
+    }
+  CHECK (filesize (fd) == TEST_SIZE, "filesize \"%s\"", file_name);
+
+  msg ("read \"%s\"", file_name);
+  seek (fd, 0);
+  for (ofs = 0; ofs < TEST_SIZE; ofs += BLOCK_SIZE)
+    {
+      size_t size = TEST_SIZE - ofs < BLOCK_SIZE ? TEST_SIZE - ofs : BLOCK_SIZE;
+
+      if (read (fd, block, size) != (int) size)
+        fail ("read %zu bytes at offset %zu failed", size, ofs);
+      fill (expected, ofs, size);
+      compare_bytes (block, expected, size, ofs, file_name);
+    }
+
+  msg ("close \"%s\"", file_name);
+  close (fd);
+}
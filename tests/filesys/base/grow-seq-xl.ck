@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(grow-seq-xl) begin
+(grow-seq-xl) create "growme"
+(grow-seq-xl) open "growme"
+(grow-seq-xl) grow "growme" to 4194304 bytes
+(grow-seq-xl) filesize "growme"
+(grow-seq-xl) read "growme"
+(grow-seq-xl) close "growme"
+(grow-seq-xl) end
+EOF
+pass;
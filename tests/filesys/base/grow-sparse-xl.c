@@ -0,0 +1,72 @@
+/* Grows a file to 4 MB by seeking past its end and writing one
+   sector-sized block every 64 kB, so that most of the file is
+   holes that the file system must fill with zeros.  Then checks
+   random, unaligned ranges against the expected mix of data and
+   zeros.  The shutdown "Inodes:" line shows how many extents the
+   data ended up in; compare it and the "Timer: N ticks" line
+   against the previous kernel. */
+
+#include <random.h>
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define TEST_SIZE (4 * 1024 * 1024)
+#define STRIDE (64 * 1024)
+#define BLOCK_SIZE 512
+#define CHECK_CNT 1000
+
+static char block[BLOCK_SIZE];
+static char expected[BLOCK_SIZE];
+
+/* Returns the byte expected at offset OFS: data in the last
+   BLOCK_SIZE bytes of each STRIDE, zeros elsewhere. */
+static char
+expected_byte (size_t ofs)
+{
+  if (ofs % STRIDE < STRIDE - BLOCK_SIZE)
+    return 0;
+  return (uint32_t) (ofs * 2654435761u) >> 24;
+}
+
+void
+test_main (void)
+{
+  const char *file_name = "sparse";
+  size_t ofs;
+  size_t i;
+  int fd;
+
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+
+  msg ("write \"%s\" every %d bytes", file_name, STRIDE);
+  for (ofs = STRIDE - BLOCK_SIZE; ofs < TEST_SIZE; ofs += STRIDE)
+    {
+      for (i = 0; i < BLOCK_SIZE; i++)
+        block[i] = expected_byte (ofs + i);
+      seek (fd, ofs);
+      if (write (fd, block, BLOCK_SIZE) != BLOCK_SIZE)
+        fail ("write %d bytes at offset %zu failed", BLOCK_SIZE, ofs);
+    }
+  CHECK (filesize (fd) == TEST_SIZE, "filesize \"%s\"", file_name);
+
+  msg ("read \"%s\" at %d random offsets", file_name, CHECK_CNT);
+  random_init (0x5ba5);
+  for (i = 0; i < CHECK_CNT; i++)
+    {
+      size_t j;
+
+      ofs = random_ulong () % (TEST_SIZE - BLOCK_SIZE + 1);
+      seek (fd, ofs);
+      if (read (fd, block, BLOCK_SIZE) != BLOCK_SIZE)
+        fail ("read %d bytes at offset %zu failed", BLOCK_SIZE, ofs);
+      for (j = 0; j < BLOCK_SIZE; j++)
+        expected[j] = expected_byte (ofs + j);
+      compare_bytes (block, expected, BLOCK_SIZE, ofs, file_name);
+    }
+
+  msg ("close \"%s\"", file_name);
+  close (fd);
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(grow-sparse-xl) begin
+(grow-sparse-xl) create "sparse"
+(grow-sparse-xl) open "sparse"
+(grow-sparse-xl) write "sparse" every 65536 bytes
+(grow-sparse-xl) filesize "sparse"
+(grow-sparse-xl) read "sparse" at 1000 random offsets
+(grow-sparse-xl) close "sparse"
+(grow-sparse-xl) end
+EOF
+pass;
@@ -0,0 +1,64 @@
+/* Grows a 4 MB file sequentially, then reads it back from
+   random, unaligned offsets to verify its contents.  Almost every
+   seek lands far from the start of the file, so the run time is
+   dominated by how quickly the file system maps an offset to a
+   sector.  Compare the shutdown "Timer: N ticks" line against the
+   previous kernel. */
+
+#include <random.h>
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define TEST_SIZE (4 * 1024 * 1024)
+#define BLOCK_SIZE 512
+#define SEEK_CNT 2000
+
+static char block[BLOCK_SIZE];
+static char expected[BLOCK_SIZE];
+
+/* Fills BUF with the BLOCK_SIZE bytes expected at offset OFS. */
+static void
+fill (char *buf, size_t ofs)
+{
+  size_t i;
+
+  for (i = 0; i < BLOCK_SIZE; i++)
+    buf[i] = (uint32_t) ((ofs + i) * 2654435761u) >> 24;
+}
+
+void
+test_main (void)
+{
+  const char *file_name = "seekme";
+  size_t ofs;
+  int fd;
+  int i;
+
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+
+  msg ("write \"%s\"", file_name);
+  for (ofs = 0; ofs < TEST_SIZE; ofs += BLOCK_SIZE)
+    {
+      fill (block, ofs);
+      if (write (fd, block, BLOCK_SIZE) != BLOCK_SIZE)
+        fail ("write %d bytes at offset %zu failed", BLOCK_SIZE, ofs);
+    }
+
+  msg ("read \"%s\" at %d random offsets", file_name, SEEK_CNT);
+  random_init (0x5eed);
+  for (i = 0; i < SEEK_CNT; i++)
+    {
+      ofs = random_ulong () % (TEST_SIZE - BLOCK_SIZE + 1);
+      seek (fd, ofs);
+      if (read (fd, block, BLOCK_SIZE) != BLOCK_SIZE)
+        fail ("read %d bytes at offset %zu failed", BLOCK_SIZE, ofs);
+      fill (expected, ofs);
+      compare_bytes (block, expected, BLOCK_SIZE, ofs, file_name);
+    }
+
+  msg ("close \"%s\"", file_name);
+  close (fd);
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(lg-seek) begin
+(lg-seek) create "seekme"
+(lg-seek) open "seekme"
+(lg-seek) write "seekme"
+(lg-seek) read "seekme" at 2000 random offsets
+(lg-seek) close "seekme"
+(lg-seek) end
+EOF
+pass;
@@ -0,0 +1,31 @@
+/* Spawns CHILD_CNT child processes, all of which read the same
+   file over and over in sector-sized chunks and check its
+   contents.  Throughput benchmark for concurrent readers: compare
+   the "Timer: ... ticks" line printed at shutdown across file
+   system locking schemes. */
+
+#include <random.h>
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/filesys/base/par-read.h"
+
+static char buf[BUF_SIZE];
+
+void
+test_main (void) 
+{
+  pid_t children[CHILD_CNT];
+  int fd;
+
+  CHECK (create (file_name, sizeof buf), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  random_bytes (buf, sizeof buf);
+  CHECK (write (fd, buf, sizeof buf) > 0, "write \"%s\"", file_name);
+  msg ("close \"%s\"", file_name);
+  close (fd);
+
+  exec_children ("child-par-read", children, CHILD_CNT);
+  wait_children (children, CHILD_CNT);
+}
@@ -0,0 +1,10 @@
+#ifndef TESTS_FILESYS_BASE_PAR_READ_H
+#define TESTS_FILESYS_BASE_PAR_READ_H
+
+#define CHILD_CNT 8
+#define BUF_SIZE 8192
+#define CHUNK_SIZE 512
+#define ROUND_CNT 20
+static const char file_name[] = "data";
+
+#endif /* tests/filesys/base/par-read.h */
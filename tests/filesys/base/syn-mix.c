@@ -0,0 +1,33 @@
+/* Spawns CHILD_CNT child processes.  Even-numbered children
+   repeatedly rewrite and verify a file of their own while
+   odd-numbered children repeatedly read and verify a file that
+   they all share.  Throughput benchmark for file system locking:
+   with per-inode locks the writers do not hold up each other or
+   the readers, so compare the "Timer: ... ticks" line printed at
+   shutdown against a kernel with a single global lock. */
+
+#include <random.h>
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/filesys/base/syn-mix.h"
+
+static char buf[BUF_SIZE];
+
+void
+test_main (void) 
+{
+  pid_t children[CHILD_CNT];
+  int fd;
+
+  CHECK (create (shared_name, sizeof buf), "create \"%s\"", shared_name);
+  CHECK ((fd = open (shared_name)) > 1, "open \"%s\"", shared_name);
+  random_bytes (buf, sizeof buf);
+  CHECK (write (fd, buf, sizeof buf) > 0, "write \"%s\"", shared_name);
+  msg ("close \"%s\"", shared_name);
+  close (fd);
+
+  exec_children ("child-syn-mix", children, CHILD_CNT);
+  wait_children (children, CHILD_CNT);
+}
@@ -0,0 +1,29 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(syn-mix) begin
+(syn-mix) create "shared"
+(syn-mix) open "shared"
+(syn-mix) write "shared"
+(syn-mix) close "shared"
+(syn-mix) exec child 1 of 8: "child-syn-mix 0"
+(syn-mix) exec child 2 of 8: "child-syn-mix 1"
+(syn-mix) exec child 3 of 8: "child-syn-mix 2"
+(syn-mix) exec child 4 of 8: "child-syn-mix 3"
+(syn-mix) exec child 5 of 8: "child-syn-mix 4"
+(syn-mix) exec child 6 of 8: "child-syn-mix 5"
+(syn-mix) exec child 7 of 8: "child-syn-mix 6"
+(syn-mix) exec child 8 of 8: "child-syn-mix 7"
+(syn-mix) wait for child 1 of 8 returned 0 (expected 0)
+(syn-mix) wait for child 2 of 8 returned 1 (expected 1)
+(syn-mix) wait for child 3 of 8 returned 2 (expected 2)
+(syn-mix) wait for child 4 of 8 returned 3 (expected 3)
+(syn-mix) wait for child 5 of 8 returned 4 (expected 4)
+(syn-mix) wait for child 6 of 8 returned 5 (expected 5)
+(syn-mix) wait for child 7 of 8 returned 6 (expected 6)
+(syn-mix) wait for child 8 of 8 returned 7 (expected 7)
+(syn-mix) end
+EOF
+pass;
@@ -0,0 +1,10 @@
+#ifndef TESTS_FILESYS_BASE_SYN_MIX_H
+#define TESTS_FILESYS_BASE_SYN_MIX_H
+
+#define CHILD_CNT 8
+#define CHUNK_SIZE 512
+#define BUF_SIZE (8 * CHUNK_SIZE)
+#define ROUND_CNT 10
+static const char shared_name[] = "shared";
+
+#endif /* tests/filesys/base/syn-mix.h */
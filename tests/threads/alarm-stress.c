@@ -0,0 +1,87 @@
+/* Creates THREAD_CNT threads that sleep for staggered durations,
+   ITER_CNT times each, and reports how many CPU cycles the timer
+   interrupt handler spent per tick while they were sleeping.
+   Also checks that no thread is woken before its time. */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define THREAD_CNT 1000
+#define ITER_CNT 3
+
+static thread_func sleeper;
+
+static struct semaphore all_done;       /* Up'd by the last sleeper. */
+static struct lock count_lock;          /* Protects the counters. */
+static int remaining;                   /* Sleepers still running. */
+static int sleep_cnt;                   /* Sleeps finished. */
+static int early_cnt;                   /* Premature wakeups seen. */
+
+void
+test_alarm_stress (void) 
+{
+  struct timer_intr_stats stats;
+  int64_t start_time, elapsed;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&all_done, 0);
+  lock_init (&count_lock);
+  remaining = THREAD_CNT;
+  sleep_cnt = 0;
+  early_cnt = 0;
+
+  msg ("Creating %d threads to sleep %d times each.", THREAD_CNT, ITER_CNT);
+  start_time = timer_ticks ();
+  timer_reset_intr_stats ();
+  for (i = 0; i < THREAD_CNT; i++) 
+    {
+      char name[16];
+      snprintf (name, sizeof name, "sleeper %d", i);
+      if (thread_create (name, PRI_DEFAULT, sleeper,
+                         (void *) (intptr_t) (1 + i * 7 % 150)) == TID_ERROR)
+        fail ("could not create thread %d", i);
+    }
+  sema_down (&all_done);
+  timer_get_intr_stats (&stats);
+  elapsed = timer_elapsed (start_time);
+
+  msg ("%d sleeps finished, %d of them early.", sleep_cnt, early_cnt);
+  msg ("Last sleeper finished after %"PRId64" ticks.", elapsed);
+  if (early_cnt != 0)
+    fail ("%d sleeps ended early", early_cnt);
+  msg ("%"PRId64" timer interrupts, %"PRIu64" cycles per tick on average, "
+       "%"PRIu64" at most.", stats.count,
+       stats.count > 0 ? stats.cycles / stats.count : 0, stats.max_cycles);
+  pass ();
+}
+
+static void
+sleeper (void *duration_) 
+{
+  int duration = (intptr_t) duration_;
+  int early = 0;
+  int i;
+
+  for (i = 0; i < ITER_CNT; i++) 
+    {
+      int64_t start = timer_ticks ();
+      timer_sleep (duration);
+      if (timer_elapsed (start) < duration)
+        early++;
+    }
+
+  lock_acquire (&count_lock);
+  sleep_cnt += ITER_CNT;
+  early_cnt += early;
+  if (--remaining == 0)
+    sema_up (&all_done);
+  lock_release (&count_lock);
+}
@@ -0,0 +1,40 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+fail "missing PASS in output"
+  unless grep ($_ eq '(alarm-stress) PASS', @output);
+
+# Every one of the 1000 threads sleeps 3 times, and none wakes early.
+fail "wrong number of sleeps, or early wakeups\n"
+  unless grep ($_ eq '(alarm-stress) 3000 sleeps finished, 0 of them early.',
+	       @output);
+
+# The longest sleeper sleeps 150 ticks, 3 times.
+my ($elapsed);
+foreach (@output) {
+    ($elapsed) = /Last sleeper finished after (\d+) ticks\./ and last;
+}
+fail "missing elapsed time in output\n" if !defined $elapsed;
+fail "all sleeps finished after $elapsed ticks, expected at least 450\n"
+  if $elapsed < 450;
+
+my ($count, $avg, $max);
+foreach (@output) {
+    ($count, $avg, $max)
+      = /(\d+) timer interrupts, (\d+) cycles per tick on average, (\d+) at most\./
+      and last;
+}
+fail "missing timer interrupt statistics in output\n" if !defined $count;
+fail "no timer interrupts counted while threads slept\n" if $count == 0;
+fail "average of $avg cycles per tick exceeds maximum of $max\n"
+  if $avg > $max;
+
+pass;
@@ -0,0 +1,82 @@
+/* Creates THREAD_CNT threads with assorted nice values that
+   alternate between spinning and sleeping for RUN_SECS seconds,
+   and reports how many CPU cycles the timer interrupt handler
+   spent per tick meanwhile, including the worst single tick.
+   With the MLFQS every tick does some scheduler bookkeeping, and
+   every second boundary used to touch every thread. */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define THREAD_CNT 500
+#define RUN_SECS 10
+
+static thread_func worker;
+
+static struct semaphore all_done;       /* Up'd by the last worker. */
+static struct lock count_lock;          /* Protects remaining. */
+static int remaining;                   /* Workers still running. */
+static int64_t end_time;                /* When workers stop. */
+
+void
+test_mlfqs_latency (void) 
+{
+  struct timer_intr_stats stats;
+  int64_t start_time;
+  int i;
+
+  ASSERT (thread_mlfqs);
+
+  sema_init (&all_done, 0);
+  lock_init (&count_lock);
+  remaining = THREAD_CNT;
+
+  msg ("Creating %d threads to run for %d seconds.", THREAD_CNT, RUN_SECS);
+  start_time = timer_ticks ();
+  end_time = start_time + RUN_SECS * TIMER_FREQ;
+  timer_reset_intr_stats ();
+  for (i = 0; i < THREAD_CNT; i++) 
+    {
+      char name[16];
+      snprintf (name, sizeof name, "worker %d", i);
+      if (thread_create (name, PRI_DEFAULT, worker,
+                         (void *) (intptr_t) i) == TID_ERROR)
+        fail ("could not create thread %d", i);
+    }
+  sema_down (&all_done);
+  timer_get_intr_stats (&stats);
+
+  msg ("All %d workers finished after %"PRId64" ticks.",
+       THREAD_CNT, timer_elapsed (start_time));
+  msg ("load average %d.%02d after the run.",
+       thread_get_load_avg () / 100, thread_get_load_avg () % 100);
+  msg ("%"PRId64" timer interrupts, %"PRIu64" cycles per tick on average, "
+       "%"PRIu64" at most.", stats.count,
+       stats.count > 0 ? stats.cycles / stats.count : 0, stats.max_cycles);
+  pass ();
+}
+
+static void
+worker (void *idx_) 
+{
+  int idx = (intptr_t) idx_;
+
+  thread_set_nice (idx % (NICE_MAX + 1));
+  while (timer_ticks () < end_time) 
+    {
+      int64_t spin_until = timer_ticks () + 1 + idx % 3;
+      while (timer_ticks () < spin_until)
+        continue;
+      timer_sleep (1 + idx % 5);
+    }
+
+  lock_acquire (&count_lock);
+  if (--remaining == 0)
+    sema_up (&all_done);
+  lock_release (&count_lock);
+}
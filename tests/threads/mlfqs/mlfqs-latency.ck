@@ -0,0 +1,49 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+fail "missing PASS in output"
+  unless grep ($_ eq '(mlfqs-latency) PASS', @output);
+
+# The workers run for 10 seconds at TIMER_FREQ = 100.
+my ($elapsed);
+foreach (@output) {
+    ($elapsed) = /All 500 workers finished after (\d+) ticks\./ and last;
+}
+fail "missing worker completion in output\n" if !defined $elapsed;
+fail "workers finished after $elapsed ticks, expected at least 1000\n"
+  if $elapsed < 1000;
+
+# Some worker is always running or ready, so load_avg grows from
+# about 0, but at most 501 threads can be ready in each second.
+my ($load_avg);
+foreach (@output) {
+    ($load_avg) = /load average (\d+\.\d+) after the run\./ and last;
+}
+fail "missing load average in output\n" if !defined $load_avg;
+my ($secs) = int ($elapsed / 100) + 2;
+my ($max_load) = 501 * (1 - (59/60) ** $secs);
+fail "load average $load_avg is zero\n" if $load_avg == 0;
+fail sprintf ("load average $load_avg exceeds %.2f\n", $max_load)
+  if $load_avg > $max_load;
+
+my ($count, $avg, $max);
+foreach (@output) {
+    ($count, $avg, $max)
+      = /(\d+) timer interrupts, (\d+) cycles per tick on average, (\d+) at most\./
+      and last;
+}
+fail "missing timer interrupt statistics in output\n" if !defined $count;
+fail "only $count timer interrupts in $elapsed ticks of work\n"
+  if $count < 990;
+fail "average of $avg cycles per tick exceeds maximum of $max\n"
+  if $avg > $max;
+
+pass;
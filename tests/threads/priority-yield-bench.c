@@ -0,0 +1,107 @@
+/* Times the run queue under load.  THREAD_CNT threads of equal
+   priority are kept runnable, and each of them repeatedly wakes
+   up a blocked thread and then yields, until CYCLE_CNT
+   yield/unblock cycles have been performed in total.  With a
+   sorted ready list every one of those operations walks the
+   whole ready set; with the priority-array run queue they are
+   all constant time.
+
+   Threads of equal priority must take turns, so every yielder
+   should perform about CYCLE_CNT / THREAD_CNT of the cycles. */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define THREAD_CNT 200
+#define CYCLE_CNT 10000
+
+static thread_func yielder_func;
+static thread_func waiter_func;
+
+static struct semaphore kick;           /* Up'd once per cycle. */
+static struct semaphore finished;       /* Up'd by each yielder. */
+static volatile int cycles;             /* Cycles performed so far. */
+static volatile bool done;              /* Tells the waiter to quit. */
+static int yield_cnt[THREAD_CNT];       /* Cycles done by each yielder. */
+
+void
+test_priority_yield_bench (void) 
+{
+  int64_t start_time, elapsed;
+  int min_cnt, max_cnt;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  sema_init (&kick, 0);
+  sema_init (&finished, 0);
+  cycles = 0;
+  done = false;
+
+  /* Stay above the yielders until all of them exist. */
+  thread_set_priority (PRI_DEFAULT + 1);
+  thread_create ("waiter", PRI_DEFAULT, waiter_func, NULL);
+  for (i = 0; i < THREAD_CNT; i++) 
+    {
+      char name[16];
+      yield_cnt[i] = 0;
+      snprintf (name, sizeof name, "yielder %d", i);
+      thread_create (name, PRI_DEFAULT, yielder_func, &yield_cnt[i]);
+    }
+
+  msg ("%d runnable threads, %d yield/unblock cycles.",
+       THREAD_CNT, CYCLE_CNT);
+
+  start_time = timer_ticks ();
+  for (i = 0; i < THREAD_CNT; i++)
+    sema_down (&finished);
+  elapsed = timer_elapsed (start_time);
+
+  done = true;
+  sema_up (&kick);
+  thread_set_priority (PRI_DEFAULT);
+
+  min_cnt = max_cnt = yield_cnt[0];
+  for (i = 1; i < THREAD_CNT; i++) 
+    {
+      if (yield_cnt[i] < min_cnt)
+        min_cnt = yield_cnt[i];
+      if (yield_cnt[i] > max_cnt)
+        max_cnt = yield_cnt[i];
+    }
+  msg ("%d cycles in total, %d to %d per yielder.",
+       cycles, min_cnt, max_cnt);
+  msg ("Elapsed: %"PRId64" ticks.", elapsed);
+  pass ();
+}
+
+static void 
+yielder_func (void *cnt_) 
+{
+  int *cnt = cnt_;
+
+  while (cycles < CYCLE_CNT) 
+    {
+      cycles++;
+      (*cnt)++;
+      sema_up (&kick);
+      thread_yield ();
+    }
+  sema_up (&finished);
+}
+
+static void 
+waiter_func (void *aux UNUSED) 
+{
+  while (!done)
+    sema_down (&kick);
+}
@@ -0,0 +1,34 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+fail "missing PASS in output"
+  unless grep ($_ eq '(priority-yield-bench) PASS', @output);
+
+my ($cycles, $min, $max);
+foreach (@output) {
+    ($cycles, $min, $max) = /(\d+) cycles in total, (\d+) to (\d+) per yielder\./
+      and last;
+}
+fail "missing cycle counts in output\n" if !defined $cycles;
+
+# A yielder may check the count just before another one reaches
+# 10000, so each of the 200 can overshoot by at most one.
+fail "$cycles cycles performed, expected 10000 to 10199\n"
+  if $cycles < 10000 || $cycles >= 10000 + 200;
+
+# Equal priorities take turns, so each yielder does about 50
+# cycles.  Allow some slack for timer preemption in the middle of
+# a cycle; a yielder that is starved does far fewer.
+fail "yielders performed $min to $max cycles each, "
+  . "instead of taking turns\n"
+  if $min < 40 || $max > 60;
+
+pass;
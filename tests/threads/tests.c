@@ -17,6 +17,7 @@ static const struct test tests[] =
     {"alarm-priority", test_alarm_priority},
     {"alarm-zero", test_alarm_zero},
     {"alarm-negative", test_alarm_negative},
+    {"alarm-stress", test_alarm_stress},
     {"priority-change", test_priority_change},
     {"priority-donate-one", test_priority_donate_one},
     {"priority-donate-multiple", test_priority_donate_multiple},
@@ -29,15 +30,17 @@ static const struct test tests[] =
     {"priority-preempt", test_priority_preempt},
     {"priority-sema", test_priority_sema},
     {"priority-condvar", test_priority_condvar},
-    // {"mlfqs-load-1", test_mlfqs_load_1},
-    // {"mlfqs-load-60", test_mlfqs_load_60},
-    // {"mlfqs-load-avg", test_mlfqs_load_avg},
-    // {"mlfqs-recent-1", test_mlfqs_recent_1},
-    // {"mlfqs-fair-2", test_mlfqs_fair_2},
-    // {"mlfqs-fair-20", test_mlfqs_fair_20},
-    // {"mlfqs-nice-2", test_mlfqs_nice_2},
-    // {"mlfqs-nice-10", test_mlfqs_nice_10},
-    // {"mlfqs-block", test_mlfqs_block},
+    {"priority-yield-bench", test_priority_yield_bench},
+    {"mlfqs-load-1", test_mlfqs_load_1},
+    {"mlfqs-load-60", test_mlfqs_load_60},
+    {"mlfqs-load-avg", test_mlfqs_load_avg},
+    {"mlfqs-recent-1", test_mlfqs_recent_1},
+    {"mlfqs-fair-2", test_mlfqs_fair_2},
+    {"mlfqs-fair-20", test_mlfqs_fair_20},
+    {"mlfqs-nice-2", test_mlfqs_nice_2},
+    {"mlfqs-nice-10", test_mlfqs_nice_10},
+    {"mlfqs-block", test_mlfqs_block},
+    {"mlfqs-latency", test_mlfqs_latency},
   };
 
 static const char *test_name;
@@ -0,0 +1,34 @@
+/* Child process of lazy-exec.
+   Its executable carries 2 MB of initialized data, of which it
+   touches only a few pages.  Exits with the number of untouched
+   pages that were nevertheless loaded, which should be 0. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+const char *test_name = "child-big";
+
+#define PAGE_SIZE 4096
+#define PAGE_CNT 512
+#define TOUCH_STRIDE 128
+
+/* Initialized, so that it occupies the executable file. */
+static char big[PAGE_CNT * PAGE_SIZE] = { 1 };
+
+int
+main (int argc UNUSED, char *argv[] UNUSED)
+{
+  int loaded = 0;
+  size_t i;
+
+  for (i = 0; i < PAGE_CNT; i += TOUCH_STRIDE)
+    if (big[i * PAGE_SIZE] != (i == 0))
+      fail ("page %zu has bad contents", i);
+
+  for (i = 0; i < PAGE_CNT; i++)
+    if (i % TOUCH_STRIDE != 0 && get_phys_addr (&big[i * PAGE_SIZE]) != 0)
+      loaded++;
+
+  return loaded;
+}
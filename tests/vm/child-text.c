@@ -0,0 +1,45 @@
+/* Child process of share-text.
+   Reads every page of its 2 MB of read-only data.  Then, if its
+   argument N is positive, runs "child-text N-1" while it is still
+   alive and returns that child's exit status.  Returns 0 if all
+   the data read back correctly. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+const char *test_name = "child-text";
+
+#define PAGE_SIZE 4096
+#define PAGE_CNT 512
+
+/* Read-only and initialized, so it lives in the executable's
+   read-only segment. */
+static const char text[PAGE_CNT * PAGE_SIZE] = { 1 };
+
+int
+main (int argc, char *argv[])
+{
+  int depth = argc > 1 ? atoi (argv[1]) : 0;
+  char cmd[32];
+  pid_t pid;
+  size_t i;
+
+  for (i = 0; i < PAGE_CNT; i++)
+    if (text[i * PAGE_SIZE] != (i == 0))
+      fail ("page %zu has bad contents", i);
+
+  if (depth == 0)
+    return 0;
+
+  snprintf (cmd, sizeof cmd, "child-text %d", depth - 1);
+  pid = fork ("child-text");
+  if (pid == 0)
+    {
+      if (exec (cmd) == -1)
+        fail ("failed to exec %s", cmd);
+    }
+  return wait (pid);
+}
@@ -0,0 +1,43 @@
+/* Forks a process with 4 MB of dirty memory and has each child
+   exec child-simple right away, many times over.  With
+   copy-on-write, fork maps the parent's frames instead of copying
+   them, which the children check before they exec. */
+
+#include <syscall.h>
+#include <stdint.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGE_CNT 1024
+#define FORK_CNT 10
+
+static char buf[PAGE_CNT * PAGE_SIZE];
+static void *pa[PAGE_CNT];
+
+void
+test_main (void)
+{
+	size_t i;
+	int n;
+
+	for (i = 0; i < PAGE_CNT; i++) {
+		buf[i * PAGE_SIZE] = i;
+		pa[i] = get_phys_addr (&buf[i * PAGE_SIZE]);
+	}
+	msg ("dirty 4 MB");
+
+	for (n = 0; n < FORK_CNT; n++) {
+		pid_t child = fork ("child-simple");
+		if (child == 0) {
+			for (i = 0; i < PAGE_CNT; i++)
+				if (get_phys_addr (&buf[i * PAGE_SIZE]) != pa[i])
+					fail ("fork %d copied page %zu", n, i);
+			exec ("child-simple");
+			fail ("failed to exec child-simple");
+		}
+		if (wait (child) != 81)
+			fail ("child %d failed", n);
+	}
+	msg ("fork and exec %d times", FORK_CNT);
+}
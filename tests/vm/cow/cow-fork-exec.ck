@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(cow-fork-exec) begin
+(cow-fork-exec) dirty 4 MB
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(cow-fork-exec) fork and exec 10 times
+(cow-fork-exec) end
+EOF
+pass;
@@ -0,0 +1,59 @@
+/* Builds a binary tree of 15 processes, each of which forks its
+   children while its parents are still alive, from a root with
+   3 MB of dirty memory.  Every process writes a page of its own
+   and checks that no other process's write shows through.  A
+   root-to-leaf path alone would need 12 MB if fork copied every
+   page, more than the user pool holds; with copy-on-write the
+   whole tree fits in little more than the root's 3 MB. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGE_CNT 768
+#define DEPTH 3
+
+static char buf[PAGE_CNT * PAGE_SIZE];
+
+/* Runs node ID of the tree, DEPTH levels below the root, and
+   returns 0 if it and every node below it saw the right memory
+   contents. */
+static int
+run_node (int id, int depth)
+{
+	pid_t children[2];
+	int status = 0;
+	int i, c;
+
+	for (c = 0; c < 2 && depth < DEPTH; c++) {
+		children[c] = fork ("cow-tree");
+		if (children[c] == 0)
+			exit (run_node (2 * id + 1 + c, depth + 1));
+		if (children[c] < 0)
+			return 1;
+	}
+
+	buf[id * PAGE_SIZE] = ~id;
+
+	for (c = 0; c < 2 && depth < DEPTH; c++)
+		if (wait (children[c]) != 0)
+			status = 1;
+
+	for (i = 0; i < PAGE_CNT; i++)
+		if (buf[i * PAGE_SIZE] != (char) (i == id ? ~id : i))
+			status = 1;
+	return status;
+}
+
+void
+test_main (void)
+{
+	size_t i;
+
+	for (i = 0; i < PAGE_CNT; i++)
+		buf[i * PAGE_SIZE] = i;
+	msg ("dirty 3 MB");
+
+	CHECK (run_node (0, 0) == 0, "fork a tree of 15 processes");
+}
@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(cow-tree) begin
+(cow-tree) dirty 3 MB
+(cow-tree) fork a tree of 15 processes
+(cow-tree) end
+EOF
+pass;
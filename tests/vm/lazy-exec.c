@@ -0,0 +1,36 @@
+/* Runs child-big, whose executable is 2 MB, several times and
+   checks that each exec reads only a small part of it from the
+   disk: segments must be loaded page by page, on demand. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define EXEC_CNT 10
+
+/* Sectors in child-big's data segment alone. */
+#define BIG_SECTORS (2 * 1024 * 1024 / 512)
+
+void
+test_main (void)
+{
+  long long start_cnt, read_cnt;
+  int i;
+
+  start_cnt = get_fs_disk_read_cnt ();
+  for (i = 0; i < EXEC_CNT; i++)
+    {
+      pid_t pid = fork ("child-big");
+      if (pid == 0)
+        {
+          if (exec ("child-big") == -1)
+            fail ("failed to exec child-big");
+        }
+      else if (wait (pid) != 0)
+        fail ("child-big %d loaded pages it never touched", i);
+    }
+  read_cnt = get_fs_disk_read_cnt () - start_cnt;
+
+  CHECK (read_cnt < EXEC_CNT * BIG_SECTORS / 8,
+         "%d execs of child-big read less than 1/8 of it", EXEC_CNT);
+}
@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(lazy-exec) begin
+(lazy-exec) 10 execs of child-big read less than 1/8 of it
+(lazy-exec) end
+EOF
+pass;
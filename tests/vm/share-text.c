@@ -0,0 +1,34 @@
+/* Runs 4 instances of child-text at once, each of which reads all
+   2 MB of its read-only data, and checks that together they read
+   it from the disk about once: processes running the same
+   executable must share the frames of its read-only pages. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define INSTANCE_CNT 4
+
+/* Sectors in child-text's read-only data alone. */
+#define TEXT_SECTORS (2 * 1024 * 1024 / 512)
+
+void
+test_main (void)
+{
+  long long start_cnt, read_cnt;
+  pid_t pid;
+
+  start_cnt = get_fs_disk_read_cnt ();
+  pid = fork ("child-text");
+  if (pid == 0)
+    {
+      if (exec ("child-text 3") == -1)
+        fail ("failed to exec child-text");
+    }
+  CHECK (wait (pid) == 0, "run %d nested instances of child-text",
+         INSTANCE_CNT);
+  read_cnt = get_fs_disk_read_cnt () - start_cnt;
+
+  CHECK (read_cnt < 2 * TEXT_SECTORS,
+         "instances read child-text's data less than twice");
+}
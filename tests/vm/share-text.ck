@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(share-text) begin
+(share-text) run 4 nested instances of child-text
+(share-text) instances read child-text's data less than twice
+(share-text) end
+EOF
+pass;
@@ -34,8 +34,11 @@
 #endif
 #ifdef FILESYS
 #include "devices/disk.h"
+#include "filesys/buffer_cache.h"
+#include "filesys/dcache.h"
 #include "filesys/filesys.h"
 #include "filesys/fsutil.h"
+#include "filesys/inode.h"
 #endif
 
 /* Page-map-level-4 with kernel mappings only. */
@@ -222,6 +225,14 @@ parse_options (char **argv) {
 			random_init (atoi (value));
 		else if (!strcmp (name, "-mlfqs"))
 			thread_mlfqs = true;
+		else if (!strcmp (name, "-tickless"))
+			timer_tickless = true;
+#ifdef FILESYS
+		else if (!strcmp (name, "-elevator")) {
+			if (value == NULL || !disk_set_scheduler (value))
+				PANIC ("unknown disk scheduler `%s'", value ? value : "");
+		}
+#endif
 #ifdef USERPROG
 		else if (!strcmp (name, "-ul"))
 			user_page_limit = atoi (value);
@@ -327,6 +338,11 @@ usage (void) {
 			"  -f                 Format file system disk during startup.\n"
 			"  -rs=SEED           Set random number seed to SEED.\n"
 			"  -mlfqs             Use multi-level feedback queue scheduler.\n"
+			"  -tickless          Stop the timer tick while the CPU is idle.\n"
+#ifdef FILESYS
+			"  -elevator=NAME     Schedule disk requests with fifo, clook\n"
+			"                     or deadline (the default).\n"
+#endif
 #ifdef USERPROG
 			"  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif
@@ -357,6 +373,9 @@ print_stats (void) {
 	thread_print_stats ();
 #ifdef FILESYS
 	disk_print_stats ();
+	buffer_cache_print_stats ();
+	dcache_print_stats ();
+	inode_print_stats ();
 #endif
 	console_print_stats ();
 	kbd_print_stats ();
@@ -195,7 +195,8 @@ lock_acquire (struct lock *lock) {
 
 	struct thread *curr = thread_current();
 	
-	if (lock->holder) {
+	/* The MLFQS does not donate priority. */
+	if (lock->holder && !thread_mlfqs) {
 		curr->waiting_for_this_lock = lock;
 		list_push_back(&lock->holder->donors_list, &curr->d_elem);
 		donate_priority();
@@ -237,8 +238,10 @@ lock_release (struct lock *lock) {
 	ASSERT (lock_held_by_current_thread (lock));
 
 	lock->holder = NULL;
-	remove_with_lock(lock);
-	refresh_priority();
+	if (!thread_mlfqs) {
+		remove_with_lock(lock);
+		refresh_priority();
+	}
 	sema_up (&lock->semaphore);
 }
 
@@ -313,10 +316,11 @@ cond_signal (struct condition *cond, struct lock *lock UNUSED) {
 	ASSERT (!intr_context ());
 	ASSERT (lock_held_by_current_thread (lock));
 
-	if (!list_empty (&cond->waiters))
+	if (!list_empty (&cond->waiters)) {
 		list_sort(&cond->waiters, cmp_sema_priority, NULL);
 		sema_up (&list_entry (list_pop_front (&cond->waiters),
 					struct semaphore_elem, elem)->semaphore);
+	}
 }
 
 /* Wakes up all threads, if any, waiting on COND (protected by
@@ -334,6 +338,252 @@ cond_broadcast (struct condition *cond, struct lock *lock) {
 		cond_signal (cond, lock);
 }
 
+static struct rwlock_hold *rwlock_hold_find (struct thread *, const struct rwlock *);
+static void rwlock_grant_read (struct rwlock *, struct thread *);
+static void rwlock_grant_write (struct rwlock *, struct thread *);
+static void rwlock_wake (struct rwlock *);
+static void rwlock_donate (struct rwlock *);
+static void donate_to (struct thread *, int priority);
+static int rwlock_max_waiter_priority (struct rwlock *);
+
+/* Initializes RW as unheld. */
+void
+rwlock_init (struct rwlock *rw) {
+	ASSERT (rw != NULL);
+
+	rw->writer = NULL;
+	rw->reader_cnt = 0;
+	list_init (&rw->readers);
+	list_init (&rw->read_waiters);
+	list_init (&rw->write_waiters);
+}
+
+/* Acquires RW for reading, sleeping while it is held for writing
+   or a writer is waiting for it.  The current thread must not
+   already hold RW in either mode: a second read acquisition
+   could deadlock behind a waiting writer.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_read (struct rwlock *rw) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+
+	ASSERT (rw != NULL);
+	ASSERT (!intr_context ());
+
+	old_level = intr_disable ();
+	ASSERT (rwlock_hold_find (curr, rw) == NULL);
+	if (rw->writer == NULL && list_empty (&rw->write_waiters)) {
+		rwlock_grant_read (rw, curr);
+	} else {
+		list_insert_ordered (&rw->read_waiters, &curr->elem, cmp_priority, NULL);
+		rwlock_donate (rw);
+		/* rwlock_wake() grants us RW before waking us up. */
+		thread_block ();
+	}
+	intr_set_level (old_level);
+}
+
+/* Releases RW, which the current thread must hold for reading. */
+void
+rwlock_release_read (struct rwlock *rw) {
+	struct rwlock_hold *hold;
+	enum intr_level old_level;
+
+	ASSERT (rw != NULL);
+
+	old_level = intr_disable ();
+	hold = rwlock_hold_find (thread_current (), rw);
+	ASSERT (hold != NULL && rw->writer == NULL);
+	list_remove (&hold->elem);
+	hold->rwlock = NULL;
+	if (--rw->reader_cnt == 0)
+		rwlock_wake (rw);
+
+	if (!thread_mlfqs)
+		refresh_priority ();
+	intr_set_level (old_level);
+	test_max_priority ();
+}
+
+/* Acquires RW for writing, sleeping until no other thread holds
+   it in either mode.  The current thread must not already hold
+   RW.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_write (struct rwlock *rw) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+
+	ASSERT (rw != NULL);
+	ASSERT (!intr_context ());
+
+	old_level = intr_disable ();
+	ASSERT (rwlock_hold_find (curr, rw) == NULL);
+	if (rw->writer == NULL && rw->reader_cnt == 0) {
+		rwlock_grant_write (rw, curr);
+	} else {
+		list_insert_ordered (&rw->write_waiters, &curr->elem, cmp_priority, NULL);
+		rwlock_donate (rw);
+		/* rwlock_wake() grants us RW before waking us up. */
+		thread_block ();
+	}
+	intr_set_level (old_level);
+}
+
+/* Releases RW, which the current thread must hold for writing. */
+void
+rwlock_release_write (struct rwlock *rw) {
+	struct rwlock_hold *hold;
+	enum intr_level old_level;
+
+	ASSERT (rw != NULL);
+
+	old_level = intr_disable ();
+	ASSERT (rw->writer == thread_current ());
+	hold = rwlock_hold_find (rw->writer, rw);
+	hold->rwlock = NULL;
+	rw->writer = NULL;
+	rwlock_wake (rw);
+
+	if (!thread_mlfqs)
+		refresh_priority ();
+	intr_set_level (old_level);
+	test_max_priority ();
+}
+
+/* Returns true if the current thread holds RW for writing. */
+bool
+rwlock_write_held_by_current_thread (const struct rwlock *rw) {
+	ASSERT (rw != NULL);
+
+	return rw->writer == thread_current ();
+}
+
+/* Returns T's hold on RW, or a null pointer if T does not hold
+   RW. */
+static struct rwlock_hold *
+rwlock_hold_find (struct thread *t, const struct rwlock *rw) {
+	int i;
+
+	for (i = 0; i < RWLOCK_HOLD_MAX; i++)
+		if (t->rw_holds[i].rwlock == rw)
+			return &t->rw_holds[i];
+	return NULL;
+}
+
+/* Records that T holds RW, using one of T's free hold slots. */
+static struct rwlock_hold *
+rwlock_hold_add (struct thread *t, struct rwlock *rw) {
+	struct rwlock_hold *hold = rwlock_hold_find (t, NULL);
+
+	if (hold == NULL)
+		PANIC ("thread %s holds too many rwlocks", t->name);
+	hold->rwlock = rw;
+	hold->thread = t;
+	return hold;
+}
+
+/* Makes T a reader of RW.  Interrupts must be off. */
+static void
+rwlock_grant_read (struct rwlock *rw, struct thread *t) {
+	struct rwlock_hold *hold = rwlock_hold_add (t, rw);
+
+	list_push_back (&rw->readers, &hold->elem);
+	rw->reader_cnt++;
+}
+
+/* Makes T the writer of RW.  Interrupts must be off. */
+static void
+rwlock_grant_write (struct rwlock *rw, struct thread *t) {
+	rwlock_hold_add (t, rw);
+	rw->writer = t;
+}
+
+/* Hands RW, which no thread holds any more, to the highest
+   priority waiting writer if there is one, or else to all the
+   waiting readers, and wakes them.  Interrupts must be off. */
+static void
+rwlock_wake (struct rwlock *rw) {
+	ASSERT (rw->writer == NULL && rw->reader_cnt == 0);
+
+	if (!list_empty (&rw->write_waiters)) {
+		struct thread *t;
+
+		/* Priorities may have changed while they waited. */
+		list_sort (&rw->write_waiters, cmp_priority, NULL);
+		t = list_entry (list_pop_front (&rw->write_waiters), struct thread, elem);
+		rwlock_grant_write (rw, t);
+		thread_unblock (t);
+	} else
+		while (!list_empty (&rw->read_waiters)) {
+			struct thread *t = list_entry (list_pop_front (&rw->read_waiters),
+					struct thread, elem);
+			rwlock_grant_read (rw, t);
+			thread_unblock (t);
+		}
+}
+
+/* Donates the current thread's priority to every holder of RW,
+   which it is about to wait for.  Interrupts must be off. */
+static void
+rwlock_donate (struct rwlock *rw) {
+	int priority = thread_current ()->priority;
+	struct list_elem *e;
+
+	/* The MLFQS does not donate priority. */
+	if (thread_mlfqs)
+		return;
+
+	if (rw->writer != NULL)
+		donate_to (rw->writer, priority);
+	for (e = list_begin (&rw->readers); e != list_end (&rw->readers); e = list_next (e))
+		donate_to (list_entry (e, struct rwlock_hold, elem)->thread, priority);
+}
+
+/* Raises T's priority to PRIORITY, and passes it on down the chain
+   of locks that T may be waiting for. */
+static void
+donate_to (struct thread *t, int priority) {
+	int depth;
+
+	for (depth = 0; depth < MAX_DONATION_DEPTH && t != NULL; depth++) {
+		if (t->priority >= priority)
+			break;
+		thread_change_priority (t, priority);
+		if (!t->waiting_for_this_lock)
+			break;
+		t = t->waiting_for_this_lock->holder;
+	}
+}
+
+/* Returns the highest priority among the threads waiting for RW,
+   or PRI_MIN if there are none. */
+static int
+rwlock_max_waiter_priority (struct rwlock *rw) {
+	struct list *lists[] = { &rw->read_waiters, &rw->write_waiters };
+	int priority = PRI_MIN;
+	enum intr_level old_level;
+	size_t i;
+
+	old_level = intr_disable ();
+	for (i = 0; i < sizeof lists / sizeof *lists; i++) {
+		struct list_elem *e;
+
+		for (e = list_begin (lists[i]); e != list_end (lists[i]); e = list_next (e)) {
+			struct thread *t = list_entry (e, struct thread, elem);
+			if (t->priority > priority)
+				priority = t->priority;
+		}
+	}
+	intr_set_level (old_level);
+	return priority;
+}
+
 /* 세마포어 요소로부터 스레드 디스크립터를 얻어서 그를 통해 스레드 자체를 가져와 Priority 비교 */
 bool
 cmp_sema_priority (const struct list_elem *a, const struct list_elem *b, void *aux)
@@ -361,7 +611,7 @@ donate_priority(void)
 	for (depth = 0; depth < MAX_DONATION_DEPTH; depth++) {
 		if (!t->waiting_for_this_lock) break;
 		holder = t->waiting_for_this_lock->holder;
-		holder->priority = t->priority;
+		thread_change_priority(holder, t->priority);
 		t = holder;
 	}
 }
@@ -398,6 +648,16 @@ refresh_priority(void)
 			curr->priority = top_pri_donator->priority;
 		}
 	}
+
+	/* Threads waiting for rwlocks we hold donate as well. */
+	for (int i = 0; i < RWLOCK_HOLD_MAX; i++) {
+		struct rwlock *rw = curr->rw_holds[i].rwlock;
+		if (rw != NULL) {
+			int priority = rwlock_max_waiter_priority (rw);
+			if (priority > curr->priority)
+				curr->priority = priority;
+		}
+	}
 }
 
 bool
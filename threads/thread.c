@@ -2,6 +2,7 @@
 #include <debug.h>
 #include <stddef.h>
 #include <random.h>
+#include <round.h>
 #include <stdio.h>
 #include <string.h>
 #include "threads/flags.h"
@@ -10,6 +11,7 @@
 #include "threads/palloc.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
+#include "devices/timer.h"
 #include "intrinsic.h"
 #ifdef USERPROG
 #include "userprog/process.h"
@@ -24,17 +26,55 @@
    Do not modify this value. */
 #define THREAD_BASIC 0xd42df210
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
-
-/* List of processes in BLOCKED state, that is, processes
-   that must be awoken in order to go into ready_list */
-static struct list sleep_list;
-
-/* Minimum out of all wakeup_tick values of threads waiting
-   in sleep_list */
-static int64_t next_tick_to_awake;
+/* Run queue of processes in THREAD_READY state, that is,
+   processes that are ready to run but not actually running.
+   There is one FIFO per priority level, and bit N of ready_mask
+   is set iff ready_queues[N] is non-empty, so that enqueueing,
+   dequeueing and finding the highest ready priority are all
+   constant time. */
+#if PRI_MAX >= 64
+#error ready_mask needs one bit per priority level
+#endif
+static struct list ready_queues[PRI_MAX + 1];
+static uint64_t ready_mask;
+static int ready_cnt; /* Number of threads in ready_queues. */
+
+/* Processes sleeping in thread_sleep(), kept in a hierarchical
+   timing wheel keyed on wakeup_tick.  Level L has
+   SLEEP_WHEEL_SIZE slots of SLEEP_WHEEL_SIZE^L ticks each.  A
+   thread sits in level 0 once it is due within SLEEP_WHEEL_SIZE
+   ticks and is cascaded down from the higher levels as time
+   advances, so each timer tick only looks at the single level-0
+   slot that expires on that tick. */
+#define SLEEP_WHEEL_BITS 6
+#define SLEEP_WHEEL_SIZE (1 << SLEEP_WHEEL_BITS)
+#define SLEEP_WHEEL_MASK (SLEEP_WHEEL_SIZE - 1)
+#define SLEEP_WHEEL_LEVELS 4
+#define SLEEP_WHEEL_SPAN (1LL << (SLEEP_WHEEL_BITS * SLEEP_WHEEL_LEVELS))
+static struct list sleep_wheel[SLEEP_WHEEL_LEVELS][SLEEP_WHEEL_SIZE];
+static int sleep_wheel_cnt[SLEEP_WHEEL_LEVELS]; /* Sleepers per level. */
+
+/* Next tick whose level-0 slot has not been expired yet. */
+static int64_t sleep_wheel_tick;
+
+/* All live threads, linked through all_elem. */
+static struct list all_list;
+
+/* 4.4BSD scheduler state.  Rather than decaying every thread's
+   recent_cpu once a second, the timer interrupt records that
+   second's decay coefficient in mlfqs_decay[] and each thread
+   applies the coefficients it has missed, in order, when it is
+   next looked at.  Every tick, a few threads from all_list are
+   brought up to date so that blocked and ready threads' priorities
+   do not go stale.  The ring must be longer than one full sweep of
+   all_list takes, which at MLFQS_SWEEP_BATCH threads per tick
+   holds for any number of threads that fits in memory. */
+#define MLFQS_DECAY_RING 64	 /* Seconds of decay coefficients kept. */
+#define MLFQS_SWEEP_BATCH 8	 /* Threads brought up to date per tick. */
+static fixed_t load_avg;
+static int64_t mlfqs_epoch;						 /* Seconds since boot. */
+static fixed_t mlfqs_decay[MLFQS_DECAY_RING]; /* Indexed by epoch. */
+static struct list_elem *mlfqs_cursor;			 /* Sweep position in all_list. */
 
 /* Idle thread. */
 static struct thread *idle_thread;
@@ -65,8 +105,18 @@ bool thread_mlfqs;
 static void kernel_thread(thread_func *, void *aux);
 
 static void idle(void *aux UNUSED);
+static void ready_push(struct thread *);
+static struct thread *ready_pop(void);
+static int ready_max_priority(void);
 static struct thread *next_thread_to_run(void);
 static void init_thread(struct thread *, const char *name, int priority);
+static void sleep_wheel_add(struct thread *);
+static void sleep_wheel_cascade(int level, int slot);
+static void mlfqs_tick(struct thread *);
+static void mlfqs_advance(int64_t ticks, int ready);
+static void mlfqs_sweep(struct thread *, int64_t cnt);
+static void mlfqs_catch_up(struct thread *);
+static int mlfqs_priority(const struct thread *);
 static void do_schedule(int status);
 static void schedule(void);
 static tid_t allocate_tid(void);
@@ -113,13 +163,25 @@ void thread_init(void)
 
 	/* Init the globla thread context */
 	lock_init(&tid_lock);
-	list_init(&ready_list);
+	for (int pri = PRI_MIN; pri <= PRI_MAX; pri++)
+		list_init(&ready_queues[pri]);
+	ready_mask = 0;
+	ready_cnt = 0;
+	list_init(&all_list);
+	mlfqs_cursor = list_end(&all_list);
 	list_init(&destruction_req);
-	list_init(&sleep_list);
-	next_tick_to_awake = INT64_MAX;
+	for (int level = 0; level < SLEEP_WHEEL_LEVELS; level++)
+	{
+		for (int slot = 0; slot < SLEEP_WHEEL_SIZE; slot++)
+			list_init(&sleep_wheel[level][slot]);
+		sleep_wheel_cnt[level] = 0;
+	}
+	sleep_wheel_tick = 0;
 	/* Set up a thread structure for the running thread. */
 	initial_thread = running_thread();
 	init_thread(initial_thread, "main", PRI_DEFAULT);
+	if (thread_mlfqs)
+		initial_thread->priority = mlfqs_priority(initial_thread);
 	initial_thread->status = THREAD_RUNNING;
 	initial_thread->tid = allocate_tid();
 }
@@ -156,6 +218,9 @@ void thread_tick(void)
 	else
 		kernel_ticks++;
 
+	if (thread_mlfqs)
+		mlfqs_tick(t);
+
 	/* Enforce preemption. */
 	if (++thread_ticks >= TIME_SLICE)
 		intr_yield_on_return();
@@ -200,6 +265,21 @@ tid_t thread_create(const char *name, int priority,
 	init_thread(t, name, priority);
 	tid = t->tid = allocate_tid();
 
+	/* Under the MLFQS the child inherits its parent's niceness and
+	   recent_cpu, and PRIORITY is ignored. */
+	if (thread_mlfqs && function != idle)
+	{
+		struct thread *curr = thread_current();
+		enum intr_level old_level = intr_disable();
+
+		mlfqs_catch_up(curr);
+		t->nice = curr->nice;
+		t->recent_cpu = curr->recent_cpu;
+		t->mlfqs_epoch = mlfqs_epoch;
+		t->priority = mlfqs_priority(t);
+		intr_set_level(old_level);
+	}
+
 	/* 파일 디스크립터 초기화 */
 	t->fd_table = palloc_get_multiple(PAL_ZERO, FDT_PAGES);
 	if (t->fd_table == NULL)
@@ -260,7 +340,14 @@ void thread_unblock(struct thread *t)
 
 	old_level = intr_disable();
 	ASSERT(t->status == THREAD_BLOCKED);
-	list_insert_ordered(&ready_list, &t->elem, cmp_priority, NULL);
+	if (thread_mlfqs && t != idle_thread)
+	{
+		/* Its priority may have missed a second or two of decay
+		   while it was blocked. */
+		mlfqs_catch_up(t);
+		t->priority = mlfqs_priority(t);
+	}
+	ready_push(t);
 	t->status = THREAD_READY;
 	intr_set_level(old_level);
 }
@@ -310,6 +397,9 @@ void thread_exit(void)
 	/* Just set our status to dying and schedule another process.
 	   We will be destroyed during the call to schedule_tail(). */
 	intr_disable();
+	if (mlfqs_cursor == &thread_current()->all_elem)
+		mlfqs_cursor = list_next(mlfqs_cursor);
+	list_remove(&thread_current()->all_elem);
 	do_schedule(THREAD_DYING);
 	NOT_REACHED();
 }
@@ -325,7 +415,7 @@ void thread_yield(void)
 
 	old_level = intr_disable();
 	if (curr != idle_thread)
-		list_insert_ordered(&ready_list, &curr->elem, cmp_priority, NULL);
+		ready_push(curr);
 	do_schedule(THREAD_READY); // 컨텍스트 스위치 수행
 	intr_set_level(old_level);
 }
@@ -333,6 +423,10 @@ void thread_yield(void)
 /* Sets the current thread's priority to NEW_PRIORITY. */
 void thread_set_priority(int new_priority)
 {
+	/* The MLFQS computes priorities itself. */
+	if (thread_mlfqs)
+		return;
+
 	thread_current()->init_priority = new_priority;
 
 	refresh_priority();
@@ -345,31 +439,54 @@ int thread_get_priority(void)
 	return thread_current()->priority;
 }
 
-/* Sets the current thread's nice value to NICE. */
-void thread_set_nice(int nice UNUSED)
+/* Sets the current thread's nice value to NICE, recomputes its
+   priority and yields if it no longer has the highest priority. */
+void thread_set_nice(int nice)
 {
-	/* TODO: Your implementation goes here */
+	struct thread *curr = thread_current();
+	enum intr_level old_level;
+
+	ASSERT(NICE_MIN <= nice && nice <= NICE_MAX);
+
+	old_level = intr_disable();
+	/* Decay owed for past seconds uses the old niceness. */
+	mlfqs_catch_up(curr);
+	curr->nice = nice;
+	if (thread_mlfqs)
+		curr->priority = mlfqs_priority(curr);
+	intr_set_level(old_level);
+
+	test_max_priority();
 }
 
 /* Returns the current thread's nice value. */
 int thread_get_nice(void)
 {
-	/* TODO: Your implementation goes here */
-	return 0;
+	return thread_current()->nice;
 }
 
 /* Returns 100 times the system load average. */
 int thread_get_load_avg(void)
 {
-	/* TODO: Your implementation goes here */
-	return 0;
+	enum intr_level old_level = intr_disable();
+	int load = fp_round(fp_mul_int(load_avg, 100));
+	intr_set_level(old_level);
+
+	return load;
 }
 
 /* Returns 100 times the current thread's recent_cpu value. */
 int thread_get_recent_cpu(void)
 {
-	/* TODO: Your implementation goes here */
-	return 0;
+	struct thread *curr = thread_current();
+	enum intr_level old_level = intr_disable();
+	int recent;
+
+	mlfqs_catch_up(curr);
+	recent = fp_round(fp_mul_int(curr->recent_cpu, 100));
+	intr_set_level(old_level);
+
+	return recent;
 }
 
 /* Idle thread.  Executes when no other thread is ready to run.
@@ -395,6 +512,10 @@ idle(void *idle_started_ UNUSED)
 		intr_disable();
 		thread_block();
 
+		/* In tickless mode, sleep until the next deadline instead
+		   of waking on every tick. */
+		timer_idle_enter();
+
 		/* Re-enable interrupts and wait for the next one.
 
 		   The `sti' instruction disables interrupts until the
@@ -450,6 +571,13 @@ init_thread(struct thread *t, const char *name, int priority)
 	sema_init(&t->free_sema, 0);
 	t->running = NULL;
 	t->exit_status = 0;
+	t->nice = NICE_DEFAULT;
+	t->recent_cpu = 0;
+	t->mlfqs_epoch = mlfqs_epoch;
+
+	enum intr_level old_level = intr_disable();
+	list_push_back(&all_list, &t->all_elem);
+	intr_set_level(old_level);
 }
 
 /* Chooses and returns the next thread to be scheduled.  Should
@@ -460,10 +588,178 @@ init_thread(struct thread *t, const char *name, int priority)
 static struct thread *
 next_thread_to_run(void)
 {
-	if (list_empty(&ready_list))
-		return idle_thread;
+	struct thread *next = ready_pop();
+
+	return next != NULL ? next : idle_thread;
+}
+
+/* Appends T to the run queue level of its current priority.
+   Interrupts must be off. */
+static void
+ready_push(struct thread *t)
+{
+	ASSERT(intr_get_level() == INTR_OFF);
+	ASSERT(PRI_MIN <= t->priority && t->priority <= PRI_MAX);
+
+	list_push_back(&ready_queues[t->priority], &t->elem);
+	ready_mask |= 1ULL << t->priority;
+	ready_cnt++;
+}
+
+/* Removes and returns the first thread of the highest non-empty
+   run queue level, or a null pointer if no thread is ready.
+   Interrupts must be off. */
+static struct thread *
+ready_pop(void)
+{
+	struct list *queue;
+	int pri;
+
+	if (ready_mask == 0)
+		return NULL;
+
+	pri = ready_max_priority();
+	queue = &ready_queues[pri];
+	struct thread *t = list_entry(list_pop_front(queue), struct thread, elem);
+	if (list_empty(queue))
+		ready_mask &= ~(1ULL << pri);
+	ready_cnt--;
+	return t;
+}
+
+/* Returns the highest priority among the ready threads, which
+   must not be empty.  A single bit scan of ready_mask. */
+static int
+ready_max_priority(void)
+{
+	ASSERT(ready_mask != 0);
+	return 63 - __builtin_clzll(ready_mask);
+}
+
+/* Changes the effective priority of T, which may be donated, to
+   PRIORITY.  If T is sitting in the run queue it is moved to the
+   queue level that matches its new priority. */
+void thread_change_priority(struct thread *t, int priority)
+{
+	enum intr_level old_level;
+
+	ASSERT(is_thread(t));
+	ASSERT(PRI_MIN <= priority && priority <= PRI_MAX);
+
+	old_level = intr_disable();
+	if (t->status == THREAD_READY && t->priority != priority)
+	{
+		list_remove(&t->elem);
+		if (list_empty(&ready_queues[t->priority]))
+			ready_mask &= ~(1ULL << t->priority);
+		ready_cnt--;
+		t->priority = priority;
+		ready_push(t);
+	}
 	else
-		return list_entry(list_pop_front(&ready_list), struct thread, elem);
+		t->priority = priority;
+	intr_set_level(old_level);
+}
+
+/* Per-tick MLFQS bookkeeping for the running thread CURR.  Does a
+   bounded amount of work regardless of the number of threads. */
+static void
+mlfqs_tick(struct thread *curr)
+{
+	int64_t ticks = timer_ticks();
+
+	if (curr != idle_thread)
+	{
+		mlfqs_catch_up(curr);
+		curr->recent_cpu = fp_add_int(curr->recent_cpu, 1);
+	}
+	mlfqs_advance(ticks, ready_cnt + (curr != idle_thread));
+
+	/* Bring a few more threads' priorities up to date. */
+	mlfqs_sweep(curr, MLFQS_SWEEP_BATCH);
+
+	/* Only the running thread's recent_cpu grows between seconds,
+	   so it is the only priority that needs the 4-tick refresh. */
+	if (curr != idle_thread && ticks % 4 == 0)
+		curr->priority = mlfqs_priority(curr);
+
+	if (ready_mask != 0 && ready_max_priority() > curr->priority)
+		intr_yield_on_return();
+}
+
+/* Brings the priorities of the next CNT threads in all_list, other
+   than CURR and the idle thread, up to date. */
+static void
+mlfqs_sweep(struct thread *curr, int64_t cnt)
+{
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	while (cnt-- > 0 && !list_empty(&all_list))
+	{
+		struct thread *t;
+
+		if (mlfqs_cursor == list_end(&all_list))
+			mlfqs_cursor = list_begin(&all_list);
+		t = list_entry(mlfqs_cursor, struct thread, all_elem);
+		mlfqs_cursor = list_next(mlfqs_cursor);
+		if (t != curr && t != idle_thread)
+		{
+			mlfqs_catch_up(t);
+			thread_change_priority(t, mlfqs_priority(t));
+		}
+	}
+}
+
+/* Updates load_avg and records the recent_cpu decay coefficient
+   for every second boundary up to TICKS.  READY is the number of
+   threads running or ready to run, excluding the idle thread. */
+static void
+mlfqs_advance(int64_t ticks, int ready)
+{
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	while (mlfqs_epoch < ticks / TIMER_FREQ)
+	{
+		fixed_t twice_load;
+
+		load_avg = fp_div_int(fp_mul_int(load_avg, 59), 60) + fp_div_int(fp_int(ready), 60);
+		twice_load = fp_mul_int(load_avg, 2);
+		mlfqs_decay[mlfqs_epoch % MLFQS_DECAY_RING] = fp_div(twice_load, fp_add_int(twice_load, 1));
+		mlfqs_epoch++;
+	}
+}
+
+/* Applies to T's recent_cpu the once-per-second decay of every
+   second that has passed since T was last brought up to date. */
+static void
+mlfqs_catch_up(struct thread *t)
+{
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	/* Coefficients older than the ring are gone.  The sweep keeps
+	   this from happening in practice. */
+	if (mlfqs_epoch - t->mlfqs_epoch > MLFQS_DECAY_RING)
+		t->mlfqs_epoch = mlfqs_epoch - MLFQS_DECAY_RING;
+
+	for (; t->mlfqs_epoch < mlfqs_epoch; t->mlfqs_epoch++)
+	{
+		fixed_t decay = mlfqs_decay[t->mlfqs_epoch % MLFQS_DECAY_RING];
+		t->recent_cpu = fp_add_int(fp_mul(decay, t->recent_cpu), t->nice);
+	}
+}
+
+/* Returns the MLFQS priority of T given its current recent_cpu
+   and niceness. */
+static int
+mlfqs_priority(const struct thread *t)
+{
+	int priority = PRI_MAX - fp_trunc(fp_div_int(t->recent_cpu, 4)) - t->nice * 2;
+
+	if (priority < PRI_MIN)
+		priority = PRI_MIN;
+	else if (priority > PRI_MAX)
+		priority = PRI_MAX;
+	return priority;
 }
 
 /* Use iretq to launch the thread */
@@ -590,7 +886,27 @@ static void
 schedule(void)
 {
 	struct thread *curr = running_thread();
-	struct thread *next = next_thread_to_run();
+	struct thread *next;
+
+	/* Leaving the idle thread: restart the periodic tick if it was
+	   stopped.  Sleepers woken by the catch-up are eligible now. */
+	if (curr == idle_thread)
+	{
+		int64_t skipped = timer_idle_exit();
+
+		/* Do what thread_tick() would have done for each skipped
+		   tick.  thread_tick() itself cannot run here, outside the
+		   interrupt and with CURR no longer running.  The idle
+		   thread gains no recent_cpu and has no time slice, and any
+		   second that passed meanwhile had nothing ready. */
+		idle_ticks += skipped;
+		if (thread_mlfqs && skipped > 0)
+		{
+			mlfqs_advance(timer_ticks(), 0);
+			mlfqs_sweep(curr, skipped * MLFQS_SWEEP_BATCH);
+		}
+	}
+	next = next_thread_to_run();
 
 	ASSERT(intr_get_level() == INTR_OFF);
 	ASSERT(curr->status != THREAD_RUNNING);
@@ -641,6 +957,7 @@ allocate_tid(void)
 	return tid;
 }
 
+/* Puts the running thread to sleep until timer tick TICKS. */
 void thread_sleep(int64_t ticks)
 {
 	struct thread *curr = thread_current();
@@ -650,63 +967,142 @@ void thread_sleep(int64_t ticks)
 
 	old_level = intr_disable();
 	curr->wakeup_tick = ticks;
-	update_next_tick_to_awake(ticks);
 	if (curr != idle_thread)
-		list_push_back(&sleep_list, &curr->elem);
+		sleep_wheel_add(curr);
 	do_schedule(THREAD_BLOCKED);
 	intr_set_level(old_level);
 }
 
+/* Wakes up every sleeping thread whose wakeup tick is at or
+   before TICKS.  Called from the timer interrupt, so it only
+   touches the level-0 slots of the ticks that have elapsed since
+   the last call (normally one), plus an occasional cascade. */
 void thread_awake(int64_t ticks)
 {
-	struct thread *t;
-	struct list_elem *curr = list_begin(&sleep_list);
-	struct list_elem *next;
-	struct list_elem *tail = list_end(&sleep_list);
+	ASSERT(intr_get_level() == INTR_OFF);
 
-	while (curr != tail)
+	while (sleep_wheel_tick <= ticks)
 	{
-		t = list_entry(curr, struct thread, elem);
-		next = list_next(curr);
-		if (t->wakeup_tick <= ticks)
+		int64_t tick = sleep_wheel_tick;
+		int idx = tick & SLEEP_WHEEL_MASK;
+		struct list *slot = &sleep_wheel[0][idx];
+
+		/* Entering a new round of a level: pull the matching slot
+		   of the level above down into the lower levels. */
+		if (idx == 0)
+			for (int level = 1; level < SLEEP_WHEEL_LEVELS; level++)
+			{
+				int upper = (tick >> (SLEEP_WHEEL_BITS * level)) & SLEEP_WHEEL_MASK;
+				sleep_wheel_cascade(level, upper);
+				if (upper != 0)
+					break;
+			}
+
+		while (!list_empty(slot))
 		{
-			list_remove(curr);
-			thread_unblock(t);
+			struct thread *t = list_entry(list_pop_front(slot), struct thread, elem);
+			sleep_wheel_cnt[0]--;
+			if (t->wakeup_tick <= ticks)
+				thread_unblock(t);
+			else
+				sleep_wheel_add(t); /* Was clamped to the wheel's span. */
 		}
-		else
+		sleep_wheel_tick = tick + 1;
+	}
+}
+
+/* Returns a lower bound on the earliest wakeup tick of any
+   sleeping thread, or INT64_MAX if no thread is sleeping.  Exact
+   for threads due within the next SLEEP_WHEEL_SIZE ticks; for
+   the others it returns the next tick at which the wheel will
+   cascade them closer. */
+int64_t
+get_next_tick_to_awake(void)
+{
+	int64_t next = INT64_MAX;
+	enum intr_level old_level = intr_disable();
+
+	if (sleep_wheel_cnt[0] > 0)
+		for (int i = 0; i < SLEEP_WHEEL_SIZE; i++)
 		{
-			update_next_tick_to_awake(t->wakeup_tick);
+			struct list *slot = &sleep_wheel[0][(sleep_wheel_tick + i) & SLEEP_WHEEL_MASK];
+			struct list_elem *e;
+
+			for (e = list_begin(slot); e != list_end(slot); e = list_next(e))
+			{
+				struct thread *t = list_entry(e, struct thread, elem);
+				if (t->wakeup_tick < next)
+					next = t->wakeup_tick;
+			}
+			if (next != INT64_MAX)
+				break;
 		}
-		curr = next;
-	}
+
+	for (int level = 1; level < SLEEP_WHEEL_LEVELS; level++)
+		if (sleep_wheel_cnt[level] > 0)
+		{
+			int64_t cascade = ROUND_UP(sleep_wheel_tick, SLEEP_WHEEL_SIZE);
+			if (cascade < next)
+				next = cascade;
+			break;
+		}
+
+	intr_set_level(old_level);
+	return next;
 }
 
-void update_next_tick_to_awake(int64_t ticks)
+/* Files sleeping thread T into the wheel slot for its wakeup
+   tick, relative to the next tick to be expired.  Interrupts
+   must be off. */
+static void
+sleep_wheel_add(struct thread *t)
 {
-	if (ticks < next_tick_to_awake)
-	{
-		next_tick_to_awake = ticks;
-	}
+	int64_t expires = t->wakeup_tick;
+	int level;
+
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	/* Already due: expire on the next tick.  Too far away: park
+	   at the end of the wheel and rehash when it gets there. */
+	if (expires < sleep_wheel_tick)
+		expires = sleep_wheel_tick;
+	else if (expires - sleep_wheel_tick >= SLEEP_WHEEL_SPAN)
+		expires = sleep_wheel_tick + SLEEP_WHEEL_SPAN - 1;
+
+	for (level = 0; level < SLEEP_WHEEL_LEVELS - 1; level++)
+		if (expires - sleep_wheel_tick < 1LL << (SLEEP_WHEEL_BITS * (level + 1)))
+			break;
+
+	list_push_back(&sleep_wheel[level][(expires >> (SLEEP_WHEEL_BITS * level)) & SLEEP_WHEEL_MASK],
+				   &t->elem);
+	sleep_wheel_cnt[level]++;
 }
 
-int64_t
-get_next_tick_to_awake(void)
+/* Redistributes the threads in SLOT of wheel LEVEL into the
+   levels below it. */
+static void
+sleep_wheel_cascade(int level, int slot)
 {
-	return next_tick_to_awake;
+	struct list *list = &sleep_wheel[level][slot];
+
+	while (!list_empty(list))
+	{
+		struct thread *t = list_entry(list_pop_front(list), struct thread, elem);
+		sleep_wheel_cnt[level]--;
+		sleep_wheel_add(t);
+	}
 }
 
 void test_max_priority(void)
 {
 	struct thread *curr_running = running_thread();
-	struct thread *top_thread;
 	// main(init.c) -> thread_init -> allocate_tid -> lock_release
 	// -> sema_up ->test_max_priority
-	if (list_empty(&ready_list) || intr_context())
+	if (ready_mask == 0 || intr_context())
 		return;
 
-	top_thread = list_entry(list_begin(&ready_list), struct thread, elem);
 	// 새로 들어온 프로세스 우선도가 지금 돌아가는 프로세스 보다 높으면
-	if (curr_running->priority < top_thread->priority)
+	if (curr_running->priority < ready_max_priority())
 		thread_yield();
 }
 
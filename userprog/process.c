@@ -13,6 +13,7 @@
 #include "threads/flags.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/thread.h"
 #include "threads/mmu.h"
@@ -182,6 +183,14 @@ static void __do_fork(void *aux)
 
 	process_activate(current);
 #ifdef VM
+	/* The child's unloaded pages are read from its own handle on the
+	 * executable; see lazy_load_segment(). */
+	if (parent->running != NULL)
+	{
+		current->running = file_duplicate(parent->running);
+		if (current->running == NULL)
+			goto error;
+	}
 	supplemental_page_table_init(&current->spt);
 	if (!supplemental_page_table_copy(&current->spt, &parent->spt))
 		goto error;
@@ -515,6 +524,7 @@ static bool load(const char *file_name, struct intr_frame *if_)
 	}
 
 	/* 실행 중인 스레드 t의 running을 실행할 파일로 초기화*/
+	file_close(t->running);
 	t->running = file;
 
 	/* 현재 오픈한 파일에 다른내용 쓰지 못하게 함 */
@@ -776,11 +786,27 @@ static bool install_page(void *upage, void *kpage, bool writable)
  * If you want to implement the function for only project 2, implement it on the
  * upper block. */
 
+/* Where the contents of a lazily loaded page come from: READ_BYTES
+ * bytes at offset OFS in the executable, followed by zeros up to
+ * PGSIZE.  It holds no file pointer, so fork can copy it as is. */
+struct segment_aux
+{
+	off_t ofs;
+	size_t read_bytes;
+};
+
+/* Fills PAGE from the executable when it is first touched.  The
+ * executable stays open as thread_current()->running for the life
+ * of the process, and a forked child gets its own duplicate. */
 static bool lazy_load_segment(struct page *page, void *aux)
 {
-	/* TODO: Load the segment from the file */
-	/* TODO: This called when the first page fault occurs on address VA. */
-	/* TODO: VA is available when calling this function. */
+	struct segment_aux *seg = aux;
+	uint8_t *kva = page->frame->kva;
+
+	if (file_read_at(thread_current()->running, kva, seg->read_bytes, seg->ofs) != (int)seg->read_bytes)
+		return false;
+	memset(kva + seg->read_bytes, 0, PGSIZE - seg->read_bytes);
+	return true;
 }
 
 /* Loads a segment starting at offset OFS in FILE at address
@@ -795,8 +821,12 @@ static bool lazy_load_segment(struct page *page, void *aux)
  * The pages initialized by this function must be writable by the
  * user process if WRITABLE is true, read-only otherwise.
  *
+ * Nothing is read here: each page is only registered, and is filled
+ * by lazy_load_segment() on its first page fault.  Pages that are
+ * entirely zero need no file access at all.
+ *
  * Return true if successful, false if a memory allocation error
- * or disk read error occurs. */
+ * occurs. */
 static bool load_segment(struct file *file, off_t ofs, uint8_t *upage,
 						 uint32_t read_bytes, uint32_t zero_bytes, bool writable)
 {
@@ -811,16 +841,23 @@ static bool load_segment(struct file *file, off_t ofs, uint8_t *upage,
 		 * and zero the final PAGE_ZERO_BYTES bytes. */
 		size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
 		size_t page_zero_bytes = PGSIZE - page_read_bytes;
+		struct segment_aux aux = {.ofs = ofs, .read_bytes = page_read_bytes};
 
-		/* TODO: Set up aux to pass information to the lazy_load_segment. */
-		void *aux = NULL;
-		if (!vm_alloc_page_with_initializer(VM_ANON, upage,
-											writable, lazy_load_segment, aux))
+		if (page_read_bytes > 0
+				? !vm_alloc_page_with_aux(VM_ANON, upage, writable,
+										  lazy_load_segment, &aux, sizeof aux)
+				: !vm_alloc_page_with_initializer(VM_ANON, upage, writable,
+												  NULL, NULL))
 			return false;
+		/* Read-only pages read from the executable are the same in
+		 * every process running it, so they can share frames. */
+		if (!writable && page_read_bytes > 0)
+			vm_share_page(upage, file_get_inode(file), ofs, page_read_bytes);
 
 		/* Advance. */
 		read_bytes -= page_read_bytes;
 		zero_bytes -= page_zero_bytes;
+		ofs += page_read_bytes;
 		upage += PGSIZE;
 	}
 	return true;
@@ -832,11 +869,11 @@ static bool setup_stack(struct intr_frame *if_)
 	bool success = false;
 	void *stack_bottom = (void *)(((uint8_t *)USER_STACK) - PGSIZE);
 
-	/* TODO: Map the stack on stack_bottom and claim the page immediately.
-	 * TODO: If success, set the rsp accordingly.
-	 * TODO: You should mark the page is stack. */
-	/* TODO: Your code goes here */
-
+	if (vm_alloc_page(VM_ANON, stack_bottom, true) && vm_claim_page(stack_bottom))
+	{
+		success = true;
+		if_->rsp = USER_STACK;
+	}
 	return success;
 }
 #endif /* VM */
\ No newline at end of file
@@ -17,6 +17,7 @@
 void syscall_entry(void);
 void syscall_handler(struct intr_frame *);
 void check_address(void *addr);
+static void check_buffer(void *buffer, unsigned size, bool writable);
 
 void halt(void);
 void exit(int status);
@@ -62,8 +63,6 @@ void syscall_init(void)
      * until the syscall_entry swaps the userland stack to the kernel
      * mode stack. Therefore, we masked the FLAG_FL. */
     write_msr(MSR_SYSCALL_MASK, FLAG_IF | FLAG_TF | FLAG_DF | FLAG_IOPL | FLAG_AC | FLAG_NT);
-
-    lock_init(&filesys_lock);
 }
 
 /* The main system call interface */
@@ -135,10 +134,46 @@ void check_address(void *addr)
     // user virtual address 인지 ; 커널 VM이 아닌지
     // 주소가 NULL 은 아닌지
     // 유저 주소 영역내를 가르키지만 아직 할당되지 않았는지 (pml4_get_page)
-    if (!is_user_vaddr(addr) || addr == NULL || pml4_get_page(curr->pml4, addr) == NULL)
+    if (!is_user_vaddr(addr) || addr == NULL)
+    {
+        exit(-1);
+    }
+#ifdef VM
+    /* A page that has not been loaded yet is still valid. */
+    if (spt_find_page(&curr->spt, addr) == NULL)
+    {
+        exit(-1);
+    }
+#else
+    if (pml4_get_page(curr->pml4, addr) == NULL)
     {
         exit(-1);
     }
+#endif
+}
+
+/* Checks every page of the SIZE bytes at BUFFER, which the kernel
+ * is about to store into if WRITABLE.  With VM the pages are also
+ * brought in here, so that the file system never has to load them
+ * while it holds its locks.  It may still take a copy-on-write
+ * fault, which does no I/O. */
+static void check_buffer(void *buffer, unsigned size, bool writable UNUSED)
+{
+    uint8_t *end = (uint8_t *)buffer + size;
+    uint8_t *upage;
+
+    check_address(buffer);
+    for (upage = pg_round_down(buffer); upage < end; upage += PGSIZE)
+    {
+        check_address(upage < (uint8_t *)buffer ? buffer : upage);
+#ifdef VM
+        struct page *page = spt_find_page(&thread_current()->spt, upage);
+        if ((writable && !page->writable) || !vm_claim_page(upage))
+        {
+            exit(-1);
+        }
+#endif
+    }
 }
 
 void halt(void)
@@ -243,24 +278,21 @@ int open(const char *file)
 {
     // printf(" syscall - open activated");
     check_address(file);
-    lock_acquire(&filesys_lock);
 
     struct file *file_obj = filesys_open(file);
+    int fd = -1;
 
-    if (file_obj == NULL)
+    if (file_obj != NULL)
     {
-        return -1;
-    }
+        fd = add_file_to_fdt(file_obj);
 
-    int fd = add_file_to_fdt(file_obj);
-
-    /* if fd full?*/
-    if (fd == -1)
-    {
-        file_close(file_obj);
+        /* if fd full?*/
+        if (fd == -1)
+        {
+            file_close(file_obj);
+        }
     }
 
-    lock_release(&filesys_lock);
     return fd;
 }
 
@@ -282,8 +314,7 @@ int filesize(int fd)
 - 파일 디스크립터가 0이 아닐 경우 파일의 데이터를 크기만큼 저장 후 읽은 바이트 수를 리턴*/
 int read(int fd, void *buffer, unsigned size)
 {
-    check_address(buffer);
-    check_address(buffer + size - 1);
+    check_buffer(buffer, size, true);
     int read_count; // 글자수 카운트 용(for문 사용하기 위해)
 
     struct file *file_obj = find_file_by_fd(fd);
@@ -313,9 +344,7 @@ int read(int fd, void *buffer, unsigned size)
     }
     else
     {
-        lock_acquire(&filesys_lock);
         read_count = file_read(file_obj, buffer, size);
-        lock_release(&filesys_lock);
     }
 
     return read_count;
@@ -323,7 +352,7 @@ int read(int fd, void *buffer, unsigned size)
 
 int write(int fd, void *buffer, unsigned size)
 {
-    check_address(buffer);
+    check_buffer(buffer, size, false);
     int read_count;
     struct file *file_obj = find_file_by_fd(fd);
 
@@ -343,9 +372,7 @@ int write(int fd, void *buffer, unsigned size)
     }
     else
     {
-        lock_acquire(&filesys_lock);
         read_count = file_write(file_obj, buffer, size);
-        lock_release(&filesys_lock);
     }
     return read_count;
 }
@@ -8,6 +8,9 @@
  * function.
  * */
 
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/vaddr.h"
 #include "vm/vm.h"
 #include "vm/uninit.h"
 
@@ -42,18 +45,41 @@ uninit_new (struct page *page, void *va, vm_initializer *init,
 	};
 }
 
-/* Initalize the page on first fault */
+/* Initalize the page on first fault.  A page without INIT starts out
+ * zeroed.  Either way AUX has served its purpose afterward. */
 static bool
 uninit_initialize (struct page *page, void *kva) {
 	struct uninit_page *uninit = &page->uninit;
+	bool success;
 
 	/* Fetch first, page_initialize may overwrite the values */
 	vm_initializer *init = uninit->init;
 	void *aux = uninit->aux;
 
-	/* TODO: You may need to fix this function. */
-	return uninit->page_initializer (page, uninit->type, kva) &&
-		(init ? init (page, aux) : true);
+	success = uninit->page_initializer (page, uninit->type, kva);
+	if (success) {
+		if (init != NULL)
+			success = init (page, aux);
+		else
+			memset (kva, 0, PGSIZE);
+	}
+	free (aux);
+	return success;
+}
+
+/* Transmutes PAGE as on its first fault, but around KVA, which already
+ * holds the page's contents: the initialization callback is not run. */
+bool
+uninit_adopt (struct page *page, void *kva) {
+	struct uninit_page *uninit = &page->uninit;
+	void *aux = uninit->aux;
+	bool success;
+
+	ASSERT (VM_TYPE (page->operations->type) == VM_UNINIT);
+
+	success = uninit->page_initializer (page, uninit->type, kva);
+	free (aux);
+	return success;
 }
 
 /* Free the resources hold by uninit_page. Although most of pages are transmuted
@@ -62,7 +88,6 @@ uninit_initialize (struct page *page, void *kva) {
  * PAGE will be freed by the caller. */
 static void
 uninit_destroy (struct page *page) {
-	struct uninit_page *uninit UNUSED = &page->uninit;
-	/* TODO: Fill this function.
-	 * TODO: If you don't have anything to do, just return. */
+	struct uninit_page *uninit = &page->uninit;
+	free (uninit->aux);
 }
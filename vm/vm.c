@@ -1,9 +1,31 @@
 /* vm.c: Generic interface for virtual memory objects. */
 
+#include <stddef.h>
+#include <string.h>
+#include "filesys/inode.h"
 #include "threads/malloc.h"
+#include "threads/mmu.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
 #include "vm/vm.h"
 #include "vm/inspect.h"
 #include "lib/kernel/hash.h"
+
+/* Returns the thread whose supplemental page table is SPT. */
+#define spt_owner(SPT) \
+	((struct thread *) ((uint8_t *) (SPT) - offsetof (struct thread, spt)))
+
+/* Frames holding shareable read-only pages, keyed by share_key, so that
+ * every process running the same executable maps the same frames.  A
+ * frame stays in the table for as long as some page maps it.
+ * frame_lock protects the table and every frame's ref_cnt. */
+static struct hash shared_frames;
+static struct lock frame_lock;
+
+static uint64_t shared_frame_hash (const struct hash_elem *, void *);
+static bool shared_frame_less (const struct hash_elem *,
+		const struct hash_elem *, void *);
+
 /* Initializes the virtual memory subsystem by invoking each subsystem's
  * intialize codes. */
 void
@@ -15,7 +37,8 @@ vm_init (void) {
 #endif
 	register_inspect_intr ();
 	/* DO NOT MODIFY UPPER LINES. */
-	/* TODO: Your code goes here. */
+	hash_init (&shared_frames, shared_frame_hash, shared_frame_less, NULL);
+	lock_init (&frame_lock);
 }
 
 /* Get the type of the page. This function is useful if you want to know the
@@ -34,12 +57,19 @@ page_get_type (struct page *page) {
 
 /* Helpers */
 static struct frame *vm_get_victim (void);
-static bool vm_do_claim_page (struct page *page);
+static bool vm_do_claim_page (struct page *page, uint64_t *pml4);
+static bool vm_claim_shared_page (struct page *page, uint64_t *pml4);
 static struct frame *vm_evict_frame (void);
+static void page_free (struct page *page);
+static void frame_put (struct frame *frame);
 
 /* Create the pending page object with initializer. If you want to create a
  * page, do not create it directly and make it through this function or
- * `vm_alloc_page`. */
+ * `vm_alloc_page`.
+ *
+ * INIT fills the page's frame the first time the page is touched; a page
+ * without one starts out zeroed.  AUX, if not null, must come from
+ * malloc() and belongs to the page once this function succeeds. */
 bool
 vm_alloc_page_with_initializer (enum vm_type type, void *upage, bool writable,
 		vm_initializer *init, void *aux) {
@@ -50,57 +80,185 @@ vm_alloc_page_with_initializer (enum vm_type type, void *upage, bool writable,
 
 	/* Check wheter the upage is already occupied or not. */
 	if (spt_find_page (spt, upage) == NULL) {
-		/* TODO: Create the page, fetch the initialier according to the VM type,
-		 * TODO: and then create "uninit" page struct by calling uninit_new. You
-		 * TODO: should modify the field after calling the uninit_new. */
-
-		/* TODO: Insert the page into the spt. */
+		bool (*initializer) (struct page *, enum vm_type, void *);
+		struct page *page;
+
+		switch (VM_TYPE (type)) {
+			case VM_ANON:
+				initializer = anon_initializer;
+				break;
+			case VM_FILE:
+				initializer = file_backed_initializer;
+				break;
+			default:
+				goto err;
+		}
+
+		page = malloc (sizeof *page);
+		if (page == NULL)
+			goto err;
+		uninit_new (page, upage, init, type, aux, initializer);
+		page->writable = writable;
+
+		if (!spt_insert_page (spt, page)) {
+			free (page);
+			goto err;
+		}
+		return true;
 	}
 err:
 	return false;
 }
 
+/* Like vm_alloc_page_with_initializer(), but gives the page its own
+ * copy of the AUX_SIZE bytes at AUX.  A page that knows the size of
+ * its AUX stays unloaded across fork: the child gets another copy. */
+bool
+vm_alloc_page_with_aux (enum vm_type type, void *upage, bool writable,
+		vm_initializer *init, const void *aux, size_t aux_size) {
+	void *copy = malloc (aux_size);
+
+	if (copy == NULL)
+		return false;
+	memcpy (copy, aux, aux_size);
+	if (!vm_alloc_page_with_initializer (type, upage, writable, init, copy)) {
+		free (copy);
+		return false;
+	}
+	spt_find_page (&thread_current ()->spt, upage)->uninit.aux_size = aux_size;
+	return true;
+}
+
 /* Find VA from spt and return page. On error, return NULL. */
 struct page *
-spt_find_page (struct supplemental_page_table *spt UNUSED, void *va UNUSED) {
-	/* TODO: Fill this function. */
-	struct page* page = (struct page*)malloc(sizeof(struct page));
-
-	page->va = pg_round_down(va); // PGMASK와 & 연산 해 오프셋 제거(VPN 추출)
-	struct hash_elem *e = hash_find (&spt->spt_hash_table, &page->hash_elem);
+spt_find_page (struct supplemental_page_table *spt, void *va) {
+	struct page key;
+	struct hash_elem *e;
 
-	return e ? hash_entry(e, struct page, hash_elem) : NULL;
+	key.va = pg_round_down (va);
+	e = hash_find (&spt->spt_hash_table, &key.hash_elem);
+	return e != NULL ? hash_entry (e, struct page, hash_elem) : NULL;
 }
-/* 해시 요소들 비교 */
-bool
-page_compare (const struct hash_elem *a, const struct hash_elem *b, void *aux UNUSED)
-{
-	const struct page *a_p = hash_entry(a, struct page, hash_elem);
-	const struct page *b_p = hash_entry(b, struct page, hash_elem);
 
-	return a_p->va < b_p->va;
+/* Returns a hash value for page P. */
+static uint64_t
+page_hash (const struct hash_elem *p_, void *aux UNUSED) {
+	const struct page *p = hash_entry (p_, struct page, hash_elem);
+	return hash_bytes (&p->va, sizeof p->va);
 }
 
-unsigned
-hash_func (const struct hash_elem *a, void *aux UNUSED)
-{
-	const struct page *p = hash_entry(a, struct page, hash_elem);
-	return hash_bytes (&p->va, sizeof(p->va));
+/* Returns true if page A precedes page B. */
+static bool
+page_less (const struct hash_elem *a_, const struct hash_elem *b_,
+		void *aux UNUSED) {
+	const struct page *a = hash_entry (a_, struct page, hash_elem);
+	const struct page *b = hash_entry (b_, struct page, hash_elem);
+
+	return a->va < b->va;
 }
+
 /* Insert PAGE into spt with validation. */
 bool
-spt_insert_page (struct supplemental_page_table *spt UNUSED,
-		struct page *page UNUSED) {
-	int succ = false;
-	/* TODO: Fill this function. */
-
-	return succ;
+spt_insert_page (struct supplemental_page_table *spt, struct page *page) {
+	return hash_insert (&spt->spt_hash_table, &page->hash_elem) == NULL;
 }
 
 void
 spt_remove_page (struct supplemental_page_table *spt, struct page *page) {
-	vm_dealloc_page (page);
-	return true;
+	hash_delete (&spt->spt_hash_table, &page->hash_elem);
+	page_free (page);
+}
+
+/* Destroys PAGE and frees it, dropping its reference to its frame, if
+ * it has one.  The frame is unmapped from the current thread's page
+ * table. */
+static void
+page_free (struct page *page) {
+	struct frame *frame = page->frame;
+
+	destroy (page);
+	if (frame != NULL) {
+		pml4_clear_page (thread_current ()->pml4, page->va);
+		frame_put (frame);
+	}
+	free (page);
+}
+
+/* Marks the page at UPAGE, which must be read-only and not yet loaded,
+ * as holding READ_BYTES bytes at OFS in INODE followed by zeros.  Every
+ * such page with the same origin then maps one shared frame. */
+void
+vm_share_page (void *upage, struct inode *inode, off_t ofs,
+		size_t read_bytes) {
+	struct page *page = spt_find_page (&thread_current ()->spt, upage);
+
+	ASSERT (page != NULL && !page->writable && page->frame == NULL);
+
+	page->share.inode = inode;
+	page->share.ofs = ofs;
+	page->share.read_bytes = read_bytes;
+}
+
+/* Returns a hash value for shared frame F. */
+static uint64_t
+shared_frame_hash (const struct hash_elem *f_, void *aux UNUSED) {
+	const struct frame *f = hash_entry (f_, struct frame, share_elem);
+	return hash_bytes (&f->share, sizeof f->share);
+}
+
+/* Returns true if shared frame A precedes shared frame B. */
+static bool
+shared_frame_less (const struct hash_elem *a_, const struct hash_elem *b_,
+		void *aux UNUSED) {
+	const struct share_key *a = &hash_entry (a_, struct frame, share_elem)->share;
+	const struct share_key *b = &hash_entry (b_, struct frame, share_elem)->share;
+
+	if (a->inode != b->inode)
+		return a->inode < b->inode;
+	if (a->ofs != b->ofs)
+		return a->ofs < b->ofs;
+	return a->read_bytes < b->read_bytes;
+}
+
+/* Returns the shared frame holding KEY's contents with a new reference
+ * added, or a null pointer if there is none.  Must be called with
+ * frame_lock held. */
+static struct frame *
+shared_frame_get (const struct share_key *key) {
+	struct frame f, *frame;
+	struct hash_elem *e;
+
+	ASSERT (lock_held_by_current_thread (&frame_lock));
+
+	f.share = *key;
+	e = hash_find (&shared_frames, &f.share_elem);
+	if (e == NULL)
+		return NULL;
+
+	frame = hash_entry (e, struct frame, share_elem);
+	frame->ref_cnt++;
+	return frame;
+}
+
+/* Drops a reference to FRAME, freeing it once nothing maps it. */
+static void
+frame_put (struct frame *frame) {
+	bool last;
+
+	lock_acquire (&frame_lock);
+	last = --frame->ref_cnt == 0;
+	if (last && frame->share.inode != NULL)
+		hash_delete (&shared_frames, &frame->share_elem);
+	lock_release (&frame_lock);
+
+	if (last) {
+		if (frame->share.inode != NULL) {
+			inode_allow_write (frame->share.inode);
+			inode_close (frame->share.inode);
+		}
+		palloc_free_page (frame->kva);
+		free (frame);
+	}
 }
 
 /* Get the struct frame, that will be evicted. */
@@ -123,15 +281,26 @@ vm_evict_frame (void) {
 }
 
 /* palloc() and get frame. If there is no available page, evict the page
- * and return it. This always return valid address. That is, if the user pool
- * memory is full, this function evicts the frame to get the available memory
- * space.*/
+ * and return it.  That is, if the user pool memory is full, this function
+ * evicts the frame to get the available memory space.  Returns NULL only
+ * if no frame can be freed up either. */
 static struct frame *
 vm_get_frame (void) {
-	struct frame *frame = NULL;
-	/* TODO: Fill this function. */
+	struct frame *frame = malloc (sizeof *frame);
+	if (frame == NULL)
+		return NULL;
+
+	frame->kva = palloc_get_page (PAL_USER);
+	if (frame->kva == NULL) {
+		free (frame);
+		frame = vm_evict_frame ();
+		if (frame == NULL)
+			return NULL;
+	}
+	frame->page = NULL;
+	frame->ref_cnt = 1;
+	frame->share.inode = NULL;
 
-	ASSERT (frame != NULL);
 	ASSERT (frame->page == NULL);
 	return frame;
 }
@@ -141,21 +310,61 @@ static void
 vm_stack_growth (void *addr UNUSED) {
 }
 
-/* Handle the fault on write_protected page */
+/* Handle the fault on write_protected page.  PAGE is writable but maps
+ * its frame read-only because fork shared the frame; give PAGE a copy of
+ * its own, unless every other sharer has already done so. */
 static bool
-vm_handle_wp (struct page *page UNUSED) {
+vm_handle_wp (struct page *page) {
+	uint64_t *pml4 = thread_current ()->pml4;
+	struct frame *frame = page->frame;
+	struct frame *copy;
+	bool alone;
+
+	ASSERT (frame != NULL && frame->share.inode == NULL);
+
+	/* Only forking a process that maps FRAME adds references to it, so
+	 * once this process is its last user the count stays at 1. */
+	lock_acquire (&frame_lock);
+	alone = frame->ref_cnt == 1;
+	lock_release (&frame_lock);
+
+	/* Either way the page is remapped in place. */
+	if (alone) {
+		frame->page = page;
+		return pml4_set_page (pml4, page->va, frame->kva, true);
+	}
+
+	copy = vm_get_frame ();
+	if (copy == NULL)
+		return false;
+	memcpy (copy->kva, frame->kva, PGSIZE);
+	copy->page = page;
+	page->frame = copy;
+	pml4_set_page (pml4, page->va, copy->kva, true);
+	frame_put (frame);
+	return true;
 }
 
 /* Return true on success */
 bool
-vm_try_handle_fault (struct intr_frame *f UNUSED, void *addr UNUSED,
-		bool user UNUSED, bool write UNUSED, bool not_present UNUSED) {
-	struct supplemental_page_table *spt UNUSED = &thread_current ()->spt;
-	struct page *page = NULL;
-	/* TODO: Validate the fault */
-	/* TODO: Your code goes here */
-
-	return vm_do_claim_page (page);
+vm_try_handle_fault (struct intr_frame *f UNUSED, void *addr,
+		bool user UNUSED, bool write, bool not_present) {
+	struct thread *curr = thread_current ();
+	struct page *page;
+
+	/* Only user pages are ours.  The kernel faults here too, when a
+	 * system call touches a user buffer. */
+	if (addr == NULL || !is_user_vaddr (addr))
+		return false;
+
+	page = spt_find_page (&curr->spt, addr);
+	if (page == NULL || (write && !page->writable))
+		return false;
+
+	/* A present page faults only on writes it still shares. */
+	if (!not_present)
+		return write && vm_handle_wp (page);
+	return vm_do_claim_page (page, curr->pml4);
 }
 
 /* Free the page.
@@ -168,42 +377,201 @@ vm_dealloc_page (struct page *page) {
 
 /* Claim the page that allocate on VA. */
 bool
-vm_claim_page (void *va UNUSED) {
-	struct page *page = NULL;
-	/* TODO: Fill this function */
-
-	return vm_do_claim_page (page);
+vm_claim_page (void *va) {
+	struct thread *curr = thread_current ();
+	struct page *page = spt_find_page (&curr->spt, va);
+
+	if (page == NULL)
+		return false;
+	if (page->frame != NULL)
+		return true;
+	return vm_do_claim_page (page, curr->pml4);
 }
 
-/* Claim the PAGE and set up the mmu. */
+/* Claim the PAGE and set up the mmu of PML4. */
 static bool
-vm_do_claim_page (struct page *page) {
-	struct frame *frame = vm_get_frame ();
+vm_do_claim_page (struct page *page, uint64_t *pml4) {
+	struct frame *frame;
+
+	if (page->share.inode != NULL)
+		return vm_claim_shared_page (page, pml4);
+
+	frame = vm_get_frame ();
+	if (frame == NULL)
+		return false;
 
 	/* Set links */
 	frame->page = page;
 	page->frame = frame;
 
-	/* TODO: Insert page table entry to map page's VA to frame's PA. */
+	if (!pml4_set_page (pml4, page->va, frame->kva, page->writable))
+		goto fail;
+	if (!swap_in (page, frame->kva)) {
+		pml4_clear_page (pml4, page->va);
+		goto fail;
+	}
+	return true;
 
-	return swap_in (page, frame->kva);
+fail:
+	page->frame = NULL;
+	frame_put (frame);
+	return false;
+}
+
+/* Claims PAGE, a shareable page, and maps it read-only in PML4.  If a
+ * frame already holds PAGE's contents it is mapped as is; otherwise the
+ * page is loaded into a new frame, which is then published.  No I/O is
+ * done under frame_lock, so two processes faulting on the same contents
+ * at once may both load them; the one that publishes second frees its
+ * copy and maps the other. */
+static bool
+vm_claim_shared_page (struct page *page, uint64_t *pml4) {
+	struct frame *frame, *loaded;
+
+	ASSERT (!page->writable);
+
+	lock_acquire (&frame_lock);
+	frame = shared_frame_get (&page->share);
+	lock_release (&frame_lock);
+
+	if (frame != NULL) {
+		if (!uninit_adopt (page, frame->kva)) {
+			frame_put (frame);
+			return false;
+		}
+	} else {
+		loaded = vm_get_frame ();
+		if (loaded == NULL)
+			return false;
+		page->frame = loaded;
+		if (!swap_in (page, loaded->kva)) {
+			page->frame = NULL;
+			frame_put (loaded);
+			return false;
+		}
+
+		lock_acquire (&frame_lock);
+		frame = shared_frame_get (&page->share);
+		if (frame == NULL) {
+			frame = loaded;
+			frame->share = page->share;
+			hash_insert (&shared_frames, &frame->share_elem);
+		}
+		lock_release (&frame_lock);
+
+		if (frame == loaded) {
+			/* Keep the executable open and unwritable for as long as
+			 * the frame can be found in the table.  Our own reference
+			 * keeps it there until we return. */
+			inode_reopen (frame->share.inode);
+			inode_deny_write (frame->share.inode);
+		} else
+			frame_put (loaded);
+	}
+
+	page->frame = frame;
+	if (!pml4_set_page (pml4, page->va, frame->kva, false)) {
+		page->frame = NULL;
+		frame_put (frame);
+		return false;
+	}
+	return true;
 }
 
 /* Initialize new supplemental page table */
 void
-supplemental_page_table_init (struct supplemental_page_table *spt UNUSED) {
-	hash_init(&spt->spt_hash_table, hash_func, page_compare, NULL);
+supplemental_page_table_init (struct supplemental_page_table *spt) {
+	hash_init (&spt->spt_hash_table, page_hash, page_less, NULL);
 }
 
-/* Copy supplemental page table from src to dst */
+/* Copy supplemental page table from src to dst.  DST must belong to the
+ * running thread, and SRC's owner must not run meanwhile.
+ *
+ * No page is copied: DST maps every frame of SRC read-only.  Frames of
+ * writable pages become copy-on-write in SRC as well, and
+ * vm_handle_wp() copies them on the first write.  A page SRC has never
+ * touched stays unloaded in both: DST's page gets the same initializer
+ * and its own copy of AUX.  Only if AUX's size is unknown, because it
+ * came through vm_alloc_page_with_initializer(), is the page loaded
+ * into SRC first and shared like the others. */
 bool
-supplemental_page_table_copy (struct supplemental_page_table *dst UNUSED,
-		struct supplemental_page_table *src UNUSED) {
+supplemental_page_table_copy (struct supplemental_page_table *dst,
+		struct supplemental_page_table *src) {
+	struct thread *parent = spt_owner (src);
+	struct hash_iterator i;
+
+	ASSERT (dst == &thread_current ()->spt);
+
+	hash_first (&i, &src->spt_hash_table);
+	while (hash_next (&i)) {
+		struct page *src_page = hash_entry (hash_cur (&i), struct page,
+				hash_elem);
+		struct page *dst_page;
+		struct frame *frame;
+
+		if (src_page->frame == NULL) {
+			struct uninit_page *uninit = &src_page->uninit;
+
+			ASSERT (VM_TYPE (src_page->operations->type) == VM_UNINIT);
+
+			if (uninit->aux == NULL || uninit->aux_size > 0) {
+				if (!(uninit->aux != NULL
+						? vm_alloc_page_with_aux (uninit->type, src_page->va,
+							src_page->writable, uninit->init, uninit->aux,
+							uninit->aux_size)
+						: vm_alloc_page_with_initializer (uninit->type,
+							src_page->va, src_page->writable, uninit->init,
+							NULL)))
+					return false;
+				dst_page = spt_find_page (dst, src_page->va);
+				dst_page->share = src_page->share;
+				continue;
+			}
+			if (!vm_do_claim_page (src_page, parent->pml4))
+				return false;
+		}
+
+		if (!vm_alloc_page (page_get_type (src_page), src_page->va,
+					src_page->writable))
+			return false;
+		dst_page = spt_find_page (dst, src_page->va);
+		dst_page->share = src_page->share;
+
+		frame = src_page->frame;
+		lock_acquire (&frame_lock);
+		frame->ref_cnt++;
+		frame->page = NULL;
+		lock_release (&frame_lock);
+
+		if (!uninit_adopt (dst_page, frame->kva)) {
+			frame_put (frame);
+			return false;
+		}
+		dst_page->frame = frame;
+		if (!pml4_set_page (thread_current ()->pml4, dst_page->va, frame->kva,
+					false)) {
+			dst_page->frame = NULL;
+			frame_put (frame);
+			return false;
+		}
+
+		/* Remaps SRC's page in place.  SRC's page table is not active on
+		 * this CPU, and is reloaded, flushing the TLB, before SRC runs. */
+		if (src_page->writable)
+			pml4_set_page (parent->pml4, src_page->va, frame->kva, false);
+	}
+	return true;
+}
+
+/* hash_clear() destructor for supplemental_page_table_kill(). */
+static void
+page_destructor (struct hash_elem *e, void *aux UNUSED) {
+	page_free (hash_entry (e, struct page, hash_elem));
 }
 
-/* Free the resource hold by the supplemental page table */
+/* Free the resource hold by the supplemental page table.  SPT is left
+ * empty and can be reused, as process_exec() does. */
 void
-supplemental_page_table_kill (struct supplemental_page_table *spt UNUSED) {
-	/* TODO: Destroy all the supplemental_page_table hold by thread and
-	 * TODO: writeback all the modified contents to the storage. */
+supplemental_page_table_kill (struct supplemental_page_table *spt) {
+	hash_clear (&spt->spt_hash_table, page_destructor);
 }